@@ -41,7 +41,10 @@ m_logLevel(0),
 m_debugMode(false),
 m_walkLength(0),
 m_drawSpeed(1),
+m_playbackSpeed(0.0),
 m_loadOnStart(true),
+m_streamLoad(false),
+m_gpsDataCache(false),
 m_frameRate(30),
 m_fullscreen(false),
 m_imageAsCurrentPoint(false),
@@ -210,7 +213,10 @@ bool AppSettings::loadXML()
     m_xml.popTag();
 
     m_drawSpeed = m_xml.getValue("settings:drawspeed", 1.0f);
+    m_playbackSpeed = m_xml.getValue("settings:playbackspeed", 0.0);
     m_loadOnStart = m_xml.getValue("settings:loadgpsonstart",1);
+    m_streamLoad = m_xml.getValue("settings:streamload", 0) == 1;
+    m_gpsDataCache = m_xml.getValue("settings:gpsdatacache", 0) == 1;
     m_frameRate = m_xml.getValue("settings:framerate", 30);
     m_fullscreen = m_xml.getValue("settings:fullscreen", 0) == 1;
     m_imageAsCurrentPoint = m_xml.getValue("ui:imageascurrent", 0) == 1;
@@ -308,7 +314,8 @@ bool AppSettings::loadXML()
     	zaf.frameCenterX = m_xml.getAttribute("frame", "lon", 0.0, i);
     	zaf.frameCenterY = m_xml.getAttribute("frame", "lat", 0.0, i);
     	zaf.gpsId = m_xml.getAttribute("frame", "gpsid", -1, i);
-    	zaf.timestamp = m_xml.getAttribute("frame", "timestamp", "", i);
+    	zaf.time = Utils::timestampToEpoch(
+    	    m_xml.getAttribute("frame", "timestamp", "", i));
     	m_zoomAnimationFrames.push_back(zaf);
     }
 
@@ -377,6 +384,8 @@ void AppSettings::print()
 
     ofLog(OF_LOG_SILENT, "Start fullscreen: %d", m_fullscreen);
     ofLog(OF_LOG_SILENT, "Load Gps on start: %d", m_loadOnStart);
+    ofLog(OF_LOG_SILENT, "Stream load: %d", m_streamLoad);
+    ofLog(OF_LOG_SILENT, "GpsData cache: %d", m_gpsDataCache);
     ofLog(OF_LOG_SILENT, "Show image as current point: %d",
           m_imageAsCurrentPoint);
     ofLog(OF_LOG_SILENT, "Hide cursor: %d", m_hideCursor);
@@ -384,6 +393,7 @@ void AppSettings::print()
     ofLog(OF_LOG_SILENT, "Log level: %d", m_logLevel);
     ofLog(OF_LOG_SILENT, "Walk length: %d", m_walkLength);
     ofLog(OF_LOG_SILENT, "Draw speed: %d", m_drawSpeed);
+    ofLog(OF_LOG_SILENT, "Playback speed: %lf", m_playbackSpeed);
     ofLog(OF_LOG_SILENT, "Frame rate: %d", m_frameRate);
 
     ofLog(OF_LOG_SILENT, "Bounding box: size = %lf, padding = %lf",
@@ -49,9 +49,12 @@ public:
     int getLogLevel() const { return m_logLevel; }
     int getWalkLength() const { return m_walkLength; }
     float getDrawSpeed() const { return m_drawSpeed; }
+    double getPlaybackSpeed() const { return m_playbackSpeed; }
     int getFrameRate() const { return m_frameRate; }
     bool isDebugMode() const { return m_debugMode; }
     bool loadGpsOnStart() const { return m_loadOnStart; }
+    bool isStreamLoad() const { return m_streamLoad; }
+    bool useGpsDataCache() const { return m_gpsDataCache; }
     bool isFullscreen() const { return m_fullscreen; }
     bool isCurrentPointImage() const { return m_imageAsCurrentPoint; }
     bool hideCursor() const { return m_hideCursor; }
@@ -170,7 +173,10 @@ private:
     bool m_debugMode;
     int m_walkLength;
     float m_drawSpeed;
+    double m_playbackSpeed;
     bool m_loadOnStart;
+    bool m_streamLoad;
+    bool m_gpsDataCache;
     int m_frameRate;
 
     bool m_fullscreen;
@@ -38,10 +38,48 @@ catch(const std::exception& ex)
 }                                                                               \
 //------------------------------------------------------------------------------
 
+/**
+* \brief Make a 'YYYY-MM-DD' string usable as timestamp range bound.
+*
+* Day and month values one past the end are carried over, so the exclusive
+* end of a range can be given as day + 1 or month + 1.
+*/
+static std::string makeDateString(int year, int month, int day)
+{
+    static const int daysInMonth[12] = {31, 28, 31, 30, 31, 30,
+                                        31, 31, 30, 31, 30, 31};
+    if (month > 12)
+    {
+        month = 1;
+        ++year;
+    }
+    const bool isLeapYear = (year % 4 == 0 && year % 100 != 0) ||
+                            year % 400 == 0;
+    const int numDays = daysInMonth[month - 1] +
+                        (month == 2 && isLeapYear ? 1 : 0);
+    if (day > numDays)
+    {
+        day = 1;
+        if (++month > 12)
+        {
+            month = 1;
+            ++year;
+        }
+    }
+
+    char buf[16];
+    sprintf(buf, "%04d-%02d-%02d", year, month, day);
+    return std::string(buf);
+}
+
+//------------------------------------------------------------------------------
+
 DBReader::DBReader(const std::string& dbpath, bool useSpeed)
 :
 m_dbPath(dbpath),
-m_useSpeed(useSpeed)
+m_useSpeed(useSpeed),
+m_locations(boost::make_shared<LocationMap>()),
+m_chunkSize(0)
 {
 }
 
@@ -63,7 +101,10 @@ bool DBReader::setupDbConnection()
 #endif
     try
     {
-        m_dbconn.reset(new sqlite3_connection(ofToDataPath(m_dbPath, true)));
+        // Opened read-only, the loader threads each have a connection.
+        const bool readOnly = true;
+        m_dbconn.reset(new sqlite3_connection(ofToDataPath(m_dbPath, true),
+                                              readOnly));
 #ifdef TARGET_OSX
         m_dbconn->enable_load_extension(true);
         std::stringstream loadExtQuery;
@@ -78,6 +119,8 @@ bool DBReader::setupDbConnection()
         ofLogVerbose(Logger::DB_READER)
             << "Spatialite version: " << spatialiteVersion;
 
+        readLocations();
+
         return true;
     }
     CATCHDBERRORS
@@ -91,6 +134,8 @@ void DBReader::closeDbConnection()
 {
     try
     {
+        // Prepared statements have to be finalized before closing.
+        m_commands.clear();
         m_dbconn->close();
         m_dbconn.reset();
     }
@@ -103,20 +148,9 @@ bool DBReader::getGpsDataDay(GpsData& gpsData,
                              const std::string& userName,
                              int year, int month, int day)
 {
-    std::stringstream query;
-    query << getBasicQueryString();
-    query << "WHERE b.username = '";
-    query << userName;
-    query << "' AND strftime('%Y-%m-%d', a.utctimestamp) = '";
-    query << year;
-    query << "-";
-    query << (month < 10 ? "0" : "");
-    query << month;
-    query << "-";
-    query << (day < 10 ? "0" : "");
-    query << day;
-    query << "' ORDER BY datetime(a.utctimestamp);";
-    return getGpsData(gpsData, query.str());
+    return getGpsDataTimeRange(gpsData, userName,
+                               makeDateString(year, month, day),
+                               makeDateString(year, month, day + 1));
 }
 
 //------------------------------------------------------------------------------
@@ -125,28 +159,9 @@ bool DBReader::getGpsDataDayRange(GpsData& gpsData,
                                   const std::string& userName,
                                   int year, int month, int dayStart, int dayEnd)
 {
-    std::stringstream query;
-    query << getBasicQueryString();
-    query << "WHERE b.username = '";
-    query << userName;
-    query << "' AND strftime('%Y-%m-%d', a.utctimestamp) >= '";
-    query << year;
-    query << "-";
-    query << (month < 10 ? "0" : "");
-    query << month;
-    query << "-";
-    query << (dayStart < 10 ? "0" : "");
-    query << dayStart;
-    query << "' AND strftime('%Y-%m-%d', a.utctimestamp) <= '";
-    query << year;
-    query << "-";
-    query << (month < 10 ? "0" : "");
-    query << month;
-    query << "-";
-    query << (dayEnd < 10 ? "0" : "");
-    query << dayEnd;
-    query << "' ORDER BY datetime(a.utctimestamp);";
-    return getGpsData(gpsData, query.str());
+    return getGpsDataTimeRange(gpsData, userName,
+                               makeDateString(year, month, dayStart),
+                               makeDateString(year, month, dayEnd + 1));
 }
 
 //------------------------------------------------------------------------------
@@ -155,17 +170,9 @@ bool DBReader::getGpsDataMonth(GpsData& gpsData,
                                const std::string& userName,
                                int year, int month)
 {
-    std::stringstream query;
-    query << getBasicQueryString();
-    query << "WHERE b.username = '";
-    query << userName;
-    query << "' AND strftime('%Y-%m', a.utctimestamp) = '";
-    query << year;
-    query << "-";
-    query << (month < 10 ? "0" : "");
-    query << month;
-    query << "' ORDER BY datetime(a.utctimestamp);";
-    return getGpsData(gpsData, query.str());
+    return getGpsDataTimeRange(gpsData, userName,
+                               makeDateString(year, month, 1),
+                               makeDateString(year, month + 1, 1));
 }
 
 //------------------------------------------------------------------------------
@@ -174,22 +181,9 @@ bool DBReader::getGpsDataMonthRange(GpsData& gpsData,
                                     const std::string& userName,
                                     int year, int monthStart, int monthEnd)
 {
-    std::stringstream query;
-    query << getBasicQueryString();
-    query << "WHERE b.username = '";
-    query << userName;
-    query << "' AND strftime('%Y-%m', a.utctimestamp) >= '";
-    query << year;
-    query << "-";
-    query << (monthStart < 10 ? "0" : "");
-    query << monthStart;
-    query << "' AND strftime('%Y-%m', a.utctimestamp) <= '";
-    query << year;
-    query << "-";
-    query << (monthEnd < 10 ? "0" : "");
-    query << monthEnd;
-    query << "' ORDER BY datetime(a.utctimestamp);";
-    return getGpsData(gpsData, query.str());
+    return getGpsDataTimeRange(gpsData, userName,
+                               makeDateString(year, monthStart, 1),
+                               makeDateString(year, monthEnd + 1, 1));
 }
 
 //------------------------------------------------------------------------------
@@ -198,15 +192,9 @@ bool DBReader::getGpsDataYear(GpsData& gpsData,
                               const std::string& userName,
                               int year)
 {
-    std::stringstream query;
-    query << getBasicQueryString();
-    query << "WHERE b.username = '";
-    query << userName;
-    query << "' AND strftime('%Y', a.utctimestamp) = '";
-    query << (year < 10 ? "0" : "");
-    query << year;
-    query << "' ORDER BY datetime(a.utctimestamp);";
-    return getGpsData(gpsData, query.str());
+    return getGpsDataTimeRange(gpsData, userName,
+                               makeDateString(year, 1, 1),
+                               makeDateString(year + 1, 1, 1));
 }
 
 //------------------------------------------------------------------------------
@@ -215,18 +203,9 @@ bool DBReader::getGpsDataYearRange(GpsData& gpsData,
                                    const std::string& userName,
                                    int yearStart, int yearEnd)
 {
-    std::stringstream query;
-    query << getBasicQueryString();
-    query << "WHERE b.username = '";
-    query << userName;
-    query << "' AND strftime('%Y', a.utctimestamp) >= '";
-    query << (yearStart < 10 ? "0" : "");
-    query << yearStart;
-    query << "' AND strftime('%Y', a.utctimestamp) <= '";
-    query << (yearEnd < 10 ? "0" : "");
-    query << yearEnd;
-    query << "' ORDER BY datetime(a.utctimestamp);";
-    return getGpsData(gpsData, query.str());
+    return getGpsDataTimeRange(gpsData, userName,
+                               makeDateString(yearStart, 1, 1),
+                               makeDateString(yearEnd + 1, 1, 1));
 }
 
 //------------------------------------------------------------------------------
@@ -237,12 +216,13 @@ bool DBReader::getGpsDataCity(GpsData& gpsData,
 {
     std::stringstream query;
     query << getBasicQueryString();
-    query << "WHERE b.username = '";
-    query << userName;
-    query << "' AND c.city = '";
-    query << city;
-    query << "' ORDER BY datetime(a.utctimestamp);";
-    return getGpsData(gpsData, query.str());
+    query << "WHERE b.username = ? AND c.city = ? ";
+    query << "ORDER BY a.utctimestamp;";
+
+    StringVec params;
+    params.push_back(userName);
+    params.push_back(city);
+    return getGpsData(gpsData, query.str(), params);
 }
 
 //------------------------------------------------------------------------------
@@ -262,20 +242,69 @@ bool DBReader::getGpsDataAll(GpsData& gpsData, const std::string& userName)
 {
     std::stringstream query;
     query << getBasicQueryString();
-    query << "WHERE b.username = '";
-    query << userName;
-    query << "' ORDER BY datetime(a.utctimestamp);";
-    return getGpsData(gpsData, query.str());
+    query << "WHERE b.username = ? ";
+    query << "ORDER BY a.utctimestamp;";
+
+    StringVec params;
+    params.push_back(userName);
+    return getGpsData(gpsData, query.str(), params);
+}
+
+//------------------------------------------------------------------------------
+
+void DBReader::setSegmentSink(const tFnSegmentSink& sink, size_t chunkSize)
+{
+    m_segmentSink = sink;
+    m_chunkSize = chunkSize;
+}
+
+//------------------------------------------------------------------------------
+// Query helpers
+//------------------------------------------------------------------------------
+
+bool DBReader::getGpsDataTimeRange(GpsData& gpsData,
+                                   const std::string& userName,
+                                   const std::string& timeStart,
+                                   const std::string& timeEnd)
+{
+    // Half-open range directly on the timestamp column, so that an index on
+    // utctimestamp can be used instead of evaluating strftime() on every row.
+    std::stringstream query;
+    query << getBasicQueryString();
+    query << "WHERE b.username = ? ";
+    query << "AND a.utctimestamp >= ? AND a.utctimestamp < ? ";
+    query << "ORDER BY a.utctimestamp;";
+
+    StringVec params;
+    params.push_back(userName);
+    params.push_back(timeStart);
+    params.push_back(timeEnd);
+    return getGpsData(gpsData, query.str(), params);
+}
+
+//------------------------------------------------------------------------------
+
+sqlite3_command& DBReader::getCommand(const std::string& query)
+{
+    tCommandPtr& cmd = m_commands[query];
+    if (!cmd)
+    {
+        cmd.reset(new sqlite3_command(*m_dbconn, query));
+    }
+    return *cmd;
 }
 
 //------------------------------------------------------------------------------
-bool DBReader::getGpsData(GpsData& gpsData, const std::string& query)
+bool DBReader::getGpsData(GpsData& gpsData, const std::string& query,
+                          const StringVec& params)
 {
-    bool queryFirstOk = false;
-    stringstream queryMinMax;
     try
     {
-        sqlite3_command cmd(*m_dbconn, query);
+        sqlite3_command& cmd = getCommand(query);
+        for (size_t i = 0; i < params.size(); ++i)
+        {
+            cmd.bind(static_cast<int>(i) + 1, params[i]);
+        }
         sqlite3_reader reader = cmd.executereader();
 
         int lastSegment = -1;
@@ -283,7 +312,12 @@ bool DBReader::getGpsData(GpsData& gpsData, const std::string& query)
         GpsSegment gpsSeg;
         GpsPointVector gpsPointVec;
         GpsSegmentVector gpsSegmentVec;
+        size_t numChunkPoints = 0;
 
+        // Min/max values are collected while reading, so the query does not
+        // need to be run a second time.
+        ofxPoint<double> minLonLat = Utils::getPointDoubleMax();
+        ofxPoint<double> maxLonLat = Utils::getPointDoubleMin();
 
         // ---------------------------------------------------------------------
         // Get all data from query.
@@ -295,13 +329,18 @@ bool DBReader::getGpsData(GpsData& gpsData, const std::string& query)
             const double lat = reader.getdouble(1);
             const double lon = reader.getdouble(2);
             const double ele = reader.getdouble(4);
-            const string timeStamp = reader.getstring(3);
-            const string location = reader.getstring(7);
+            const tEpoch time = Utils::timestampToEpoch(reader.getstring(3));
+            const int locationId = reader.getint(7);
             const double speed = m_useSpeed ? reader.getdouble(8) : 0.0;
             const int currentSegment = reader.getint(5);
             user = reader.getstring(6);
 
-            gpsPoint.setData(id, lat, lon, ele, timeStamp, location, speed);
+            gpsPoint.setData(id, lat, lon, ele, time, locationId, speed);
+
+            minLonLat.x = MIN(lon, minLonLat.x);
+            maxLonLat.x = MAX(lon, maxLonLat.x);
+            minLonLat.y = MIN(lat, minLonLat.y);
+            maxLonLat.y = MAX(lat, maxLonLat.y);
 
             if (currentSegment != lastSegment)
             {
@@ -312,51 +351,65 @@ bool DBReader::getGpsData(GpsData& gpsData, const std::string& query)
                 }
                 else
                 {
-                    gpsSeg.setGpsSegment(gpsPointVec, lastSegment);
-                    gpsSegmentVec.push_back(gpsSeg);
+                    // Empty if the segment was just handed to the sink.
+                    if (!gpsPointVec.empty())
+                    {
+                        gpsSeg.setGpsSegment(gpsPointVec, lastSegment);
+                        gpsSegmentVec.push_back(gpsSeg);
+                        numChunkPoints += gpsPointVec.size();
+                        gpsPointVec.clear();
+                    }
                     lastSegment = currentSegment;
-                    gpsPointVec.clear();
                 }
             }
             gpsPointVec.push_back(gpsPoint);
+
+            // Flushed inside of segments too, else a long track would arrive
+            // at once. The rest of the segment follows with the same number.
+            if (m_segmentSink &&
+                numChunkPoints + gpsPointVec.size() >= m_chunkSize)
+            {
+                gpsSeg.setGpsSegment(gpsPointVec, lastSegment);
+                gpsSegmentVec.push_back(gpsSeg);
+                gpsPointVec.clear();
+                if (!m_segmentSink(gpsSegmentVec, user))
+                {
+                    return false;
+                }
+                gpsSegmentVec.clear();
+                numChunkPoints = 0;
+            }
         }
-        queryFirstOk = true;
         reader.close();
-        // -----------------------------------------------------------------------------
+        // ---------------------------------------------------------------------
+
+        if (m_segmentSink)
+        {
+            if (gpsPointVec.empty())
+            {
+                return true;
+            }
+            gpsSeg.setGpsSegment(gpsPointVec, lastSegment);
+            gpsSegmentVec.push_back(gpsSeg);
+            return m_segmentSink(gpsSegmentVec, user);
+        }
 
         gpsSeg.setGpsSegment(gpsPointVec, lastSegment);
         gpsSegmentVec.push_back(gpsSeg);
 
-        // -----------------------------------------------------------------------------
-        // Get min/max values for query.
-        // -----------------------------------------------------------------------------
-        const size_t posS = query.find("FROM");
-        const size_t posE = query.find(" ORDER");
-
-//        queryMinMax << "SELECT min(a.longitude), max(a.longitude), min(a.latitude), max(a.latitude) ";
-        queryMinMax << "SELECT min(x(a.geom)), max(x(a.geom)), "
-                    << "min(y(a.geom)), max(y(a.geom)) ";
-        // Retrieve select conditions from original database query.
-        queryMinMax << query.substr(posS, (posE - posS));
-
-        sqlite3_command cmd2(*m_dbconn, queryMinMax.str());
-        sqlite3_reader readerMinMax = cmd2.executereader();
-        double minLon, maxLon, minLat, maxLat;
-        readerMinMax.read();
-        minLon = readerMinMax.getdouble(0);
-        maxLon = readerMinMax.getdouble(1);
-        minLat = readerMinMax.getdouble(2);
-        maxLat = readerMinMax.getdouble(3);
-        readerMinMax.close();
-        // -----------------------------------------------------------------------------
+        if (gpsPointVec.empty())
+        {
+            // Empty result, same as min/max of no rows.
+            minLonLat = ofxPoint<double>(0.0, 0.0);
+            maxLonLat = ofxPoint<double>(0.0, 0.0);
+        }
+
         gpsData.clear();
-        gpsData.setGpsData(gpsSegmentVec,
-                           ofxPoint<double>(minLon, minLat),
-                           ofxPoint<double>(maxLon, maxLat),
-                           user);
+        gpsData.setGpsData(gpsSegmentVec, minLonLat, maxLonLat, user,
+                           m_locations);
         return true;
     }
-    CATCHDBERRORSQ((queryFirstOk ? queryMinMax.str() : query))
+    CATCHDBERRORSQ(query)
 
     return false;
 }
@@ -366,12 +419,14 @@ bool DBReader::getGpsData(GpsData& gpsData, const std::string& query)
 const std::string DBReader::getBasicQueryString()
 {
     // This is the part of the query string that all queries have common.
+    // Only the citydef id is read per row, names come from readLocations().
+    // The join stays, so that queries can still filter on c.city.
     stringstream query;
 
     query << "SELECT a.trkpt_uid, y(a.geom) AS latitude, x(a.geom) AS longitude,"
           << "a.utctimestamp AS time, a.ele AS elevation,"
           << "a.trkseg_id AS segment, b.username AS name, "
-          << "c.city AS city "
+          << "a.citydef_uid AS citydef "
           << (m_useSpeed ? ", a.speed AS speed " : "")
           << "FROM trackpoints AS a "
           << "JOIN users AS b ON (a.user_uid = b.user_uid) "
@@ -381,3 +436,24 @@ const std::string DBReader::getBasicQueryString()
 }
 
 //------------------------------------------------------------------------------
+
+void DBReader::readLocations()
+{
+    const std::string query = "SELECT citydef_uid, city FROM citydefs;";
+    try
+    {
+        boost::shared_ptr<LocationMap> locations =
+            boost::make_shared<LocationMap>();
+        sqlite3_command cmd(*m_dbconn, query);
+        sqlite3_reader reader = cmd.executereader();
+        while (reader.read())
+        {
+            (*locations)[reader.getint(0)] = reader.getstring(1);
+        }
+        reader.close();
+        m_locations = locations;
+    }
+    CATCHDBERRORSQ(query)
+}
+
+//------------------------------------------------------------------------------
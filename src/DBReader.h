@@ -7,8 +7,13 @@
 
 #include "GpsData.h"
 #include <string>
+#include <map>
 
-namespace sqlite3x { class sqlite3_connection; }
+namespace sqlite3x
+{
+    class sqlite3_connection;
+    class sqlite3_command;
+}
 
 class DBReader
 {
@@ -47,16 +52,62 @@ public:
                                const std::string& sqlFileSource);
     bool getGpsDataAll(GpsData& gpsData, const std::string& userName);
 
+    /**
+    * \brief Sink for segments that are read in chunks.
+    *
+    * Gets the segments of a chunk and the user name. Returning false stops
+    * reading the query.
+    */
+    typedef boost::function<bool(const GpsSegmentVector&,
+                                 const std::string&)> tFnSegmentSink;
+
+    /**
+    * \brief Pass read segments in chunks to a sink.
+    *
+    * If set, segments are given to the sink as soon as chunkSize points are
+    * read and the GpsData passed to the query functions stays empty. A
+    * segment is split between chunks, the parts keep the segment number.
+    */
+    void setSegmentSink(const tFnSegmentSink& sink, size_t chunkSize);
+
+    /**
+    * \brief Get location names of all citydefs, read once per connection.
+    */
+    const LocationMapPtr& getLocations() const { return m_locations; }
+
 private:
 
-    bool getGpsData(GpsData& gpsData, const std::string& query);
+    bool getGpsData(GpsData& gpsData, const std::string& query,
+                    const StringVec& params = StringVec());
+
+    bool getGpsDataTimeRange(GpsData& gpsData, const std::string& userName,
+                             const std::string& timeStart,
+                             const std::string& timeEnd);
+
+    /**
+    * \brief Get prepared statement for a query.
+    *
+    * Statements are compiled once and reused for all following calls on the
+    * same connection.
+    */
+    sqlite3x::sqlite3_command& getCommand(const std::string& query);
 
     const string getBasicQueryString();
 
+    void readLocations();
+
 	string m_dbPath;
     boost::scoped_ptr<sqlite3x::sqlite3_connection> m_dbconn;
 
+    typedef boost::shared_ptr<sqlite3x::sqlite3_command> tCommandPtr;
+    std::map<std::string, tCommandPtr> m_commands;
+
 	bool m_useSpeed;
 
+    LocationMapPtr m_locations;
+
+    tFnSegmentSink m_segmentSink;
+    size_t m_chunkSize;
+
 };
 #endif // _DBREADER_H_
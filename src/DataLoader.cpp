@@ -2,6 +2,12 @@
 #include "DrawingLifeIncludes.h"
 #include "DrawingLifeApp.h"
 #include "DBReader.h"
+#include "GeoUtils.h"
+#include "GpsDataCache.h"
+#include "GpsDataStreamLoader.h"
+
+#include "Poco/Environment.h"
+#include "Poco/ThreadPool.h"
 
 //------------------------------------------------------------------------------
 // GpsData loading
@@ -12,15 +18,17 @@ bool DataLoader::loadGpsDataCity(DrawingLifeApp& app,
                                  const std::string& city)
 {
     std::vector<tFuncLoadGpsData> funcVec;
+    StringVec queries;
     const size_t numPersons = app.getAppSettings().getNumPersons();
     for (size_t i = 0; i < numPersons; ++i)
     {
         tFuncLoadGpsData f =
             boost::bind(&DBReader::getGpsDataCity, _1, _2, names[i], city);
         funcVec.push_back(f);
+        queries.push_back("city: " + names[i] + ", " + city);
     }
 
-    return loadGpsData(app, funcVec);
+    return loadGpsData(app, funcVec, queries);
 }
 
 //------------------------------------------------------------------------------
@@ -30,6 +38,7 @@ bool DataLoader::loadGpsDataYearRange(DrawingLifeApp& app,
                                       int yearStart, int yearEnd)
 {
     std::vector<tFuncLoadGpsData> funcVec;
+    StringVec queries;
 
     const size_t numPersons = app.getAppSettings().getNumPersons();
     for (size_t i = 0; i < numPersons; ++i)
@@ -37,9 +46,11 @@ bool DataLoader::loadGpsDataYearRange(DrawingLifeApp& app,
         tFuncLoadGpsData f = boost::bind(&DBReader::getGpsDataYearRange, _1, _2,
                                          names[i], yearStart, yearEnd);
         funcVec.push_back(f);
+        queries.push_back("year range: " + names[i] + ", "
+                          + ofToString(yearStart) + ", " + ofToString(yearEnd));
     }
 
-    return loadGpsData(app, funcVec);
+    return loadGpsData(app, funcVec, queries);
 }
 
 //------------------------------------------------------------------------------
@@ -48,6 +59,7 @@ bool DataLoader::loadGpsDataWithSqlFile(DrawingLifeApp& app,
                                         const StringVec& sqlFilePaths)
 {
     std::vector<tFuncLoadGpsData> funcVec;
+    StringVec queries;
 
     const size_t numPersons = app.getAppSettings().getNumPersons();
     for (size_t i = 0; i < numPersons; ++i)
@@ -61,9 +73,10 @@ bool DataLoader::loadGpsDataWithSqlFile(DrawingLifeApp& app,
         tFuncLoadGpsData f =
             boost::bind(&DBReader::getGpsDataWithSqlFile, _1, _2, sqlFileSource);
         funcVec.push_back(f);
+        queries.push_back("sql: " + sqlFileSource);
     }
 
-    return loadGpsData(app, funcVec);
+    return loadGpsData(app, funcVec, queries);
 }
 
 //------------------------------------------------------------------------------
@@ -71,6 +84,7 @@ bool DataLoader::loadGpsDataWithSqlFile(DrawingLifeApp& app,
 bool DataLoader::loadGpsDataAll(DrawingLifeApp& app, const StringVec& names)
 {
     std::vector<tFuncLoadGpsData> funcVec;
+    StringVec queries;
 
     const size_t numPersons = app.getAppSettings().getNumPersons();
     for (size_t i = 0; i < numPersons; ++i)
@@ -78,9 +92,10 @@ bool DataLoader::loadGpsDataAll(DrawingLifeApp& app, const StringVec& names)
         tFuncLoadGpsData f =
             boost::bind(&DBReader::getGpsDataAll, _1, _2, names[i]);
         funcVec.push_back(f);
+        queries.push_back("all: " + names[i]);
     }
 
-    return loadGpsData(app, funcVec);
+    return loadGpsData(app, funcVec, queries);
 }
 
 //------------------------------------------------------------------------------
@@ -274,44 +289,177 @@ void DataLoader::processGpsData(DrawingLifeApp& app)
 
 //------------------------------------------------------------------------------
 
+/**
+ * \brief Worker for loading GpsData of several persons in parallel.
+ *
+ * Every worker owns its own database connection and takes the next person
+ * from the shared job list until all persons are loaded. The points are
+ * projected on the worker, GeoUtils gives every thread its own proj
+ * context.
+ */
+class DataLoader::GpsDataLoadWorker : public Poco::Runnable
+{
+public:
+
+    GpsDataLoadWorker(DBReader& dbReader, GpsDataLoadJobs& jobs)
+        : m_dbReader(dbReader), m_jobs(jobs) {}
+
+    void run()
+    {
+        size_t i;
+        while (m_jobs.next(i))
+        {
+            if (m_jobs.funcVec[i].empty())
+            {
+                // Already loaded from cache.
+                m_jobs.loadOk[i] = 1;
+                continue;
+            }
+
+            const unsigned long long loadStart = ofGetElapsedTimeMillis();
+            const tFuncLoadGpsData& getGpsDataFunc = m_jobs.funcVec[i];
+            m_jobs.loadOk[i] = getGpsDataFunc(&m_dbReader, *m_jobs.gpsDatas[i]);
+            m_jobs.loadTimes[i] = ofGetElapsedTimeMillis() - loadStart;
+        }
+    }
+
+private:
+
+    DBReader& m_dbReader;
+    GpsDataLoadJobs& m_jobs;
+};
+
+//------------------------------------------------------------------------------
+
+bool DataLoader::GpsDataLoadJobs::next(size_t& personIndex)
+{
+    Poco::FastMutex::ScopedLock lock(mutex);
+    if (nextPerson >= gpsDatas.size())
+    {
+        return false;
+    }
+    personIndex = nextPerson++;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
 bool DataLoader::loadGpsData(DrawingLifeApp& app,
-                             const std::vector<tFuncLoadGpsData>& funcVec)
+                             const std::vector<tFuncLoadGpsData>& funcVec,
+                             const StringVec& queries)
 {
     const AppSettings& settings = app.getAppSettings();
     GpsDataVector& gpsDatas = app.getGpsDataVector();
 
     app.resetData();
 
-    // get GpsData from database
     const size_t numPersons = settings.getNumPersons();
     for (size_t i = 0; i < numPersons; ++i)
     {
-        GpsDataPtr gpsData = boost::make_shared<GpsData>(settings);
-        gpsDatas.push_back(gpsData);
+        gpsDatas.push_back(boost::make_shared<GpsData>(settings));
+    }
+
+    // Persons found in the cache are not queried, their function is cleared.
+    std::vector<tFuncLoadGpsData> queryFuncVec(funcVec);
+    StringVec cacheKeys;
+    size_t numCached = 0;
+    if (settings.useGpsDataCache())
+    {
+        for (size_t i = 0; i < numPersons; ++i)
+        {
+            cacheKeys.push_back(GpsDataCache::makeKey(settings, queries[i]));
+            if (!app.isRebuildGpsDataCache() &&
+                GpsDataCache::load(cacheKeys[i], *gpsDatas[i]))
+            {
+                queryFuncVec[i].clear();
+                cacheKeys[i].clear();
+                ++numCached;
+            }
+        }
+    }
+
+    if (settings.isStreamLoad())
+    {
+        // Walks start empty and get their data while the animation runs.
+        processGpsData(app);
+        return app.getStreamLoader().start(queryFuncVec, cacheKeys);
+    }
+
+    GpsDataLoadJobs jobs(queryFuncVec, gpsDatas);
+
+    // get GpsData from database. Each worker gets its own read-only
+    // connection. Connections are opened here, so that spatialite
+    // initialization is not done concurrently.
+    const size_t numQueries = numPersons - numCached;
+    const size_t numWorkers = std::min<size_t>(
+        numQueries, std::max<size_t>(1, Poco::Environment::processorCount()));
+    if (numWorkers > 0)
+    {
+        // Projection has to be set up before it is used by the workers.
+        GeoUtils::init();
+    }
+    boost::ptr_vector<DBReader> dbReaders;
+    for (size_t i = 0; i < numWorkers; ++i)
+    {
+        DBReader* dbReader = new DBReader(settings.getDatabasePath(),
+                                          settings.useSpeed());
+        dbReaders.push_back(dbReader);
+        if (!dbReader->setupDbConnection())
+        {
+            dbReaders.pop_back();
+            break;
+        }
+    }
+
+    if (!dbReaders.empty())
+    {
+        boost::ptr_vector<GpsDataLoadWorker> workers;
+        Poco::ThreadPool threadPool(1, static_cast<int>(dbReaders.size()));
+        BOOST_FOREACH(DBReader& dbReader, dbReaders)
+        {
+            workers.push_back(new GpsDataLoadWorker(dbReader, jobs));
+            threadPool.start(workers.back());
+        }
+        threadPool.joinAll();
 
-        DBReaderPtr dbReader(new DBReader(settings.getDatabasePath(),
-                                          settings.useSpeed()));
-        if (dbReader->setupDbConnection())
+        BOOST_FOREACH(DBReader& dbReader, dbReaders)
         {
-            // -----------------------------------------------------------------
-            // DB query
-            tFuncLoadGpsData getGpsDataFunc = funcVec.at(i);
-            const bool loadOk = getGpsDataFunc(dbReader.get(), *gpsData);
+            dbReader.closeDbConnection();
+        }
+    }
 
-            dbReader->closeDbConnection();
+    if (!dbReaders.empty() || numQueries == 0)
+    {
+        // Results in person order.
+        for (size_t i = 0; i < numPersons; ++i)
+        {
+            const GpsDataPtr& gpsData = gpsDatas[i];
 
-            if (!loadOk)
+            if (queryFuncVec[i].empty())
+            {
+                ofLogNotice(Logger::DATA_LOADER) << "--> GpsData loaded from cache!";
+            }
+            else if (!jobs.loadOk[i])
             {
                 ofLogNotice(Logger::DATA_LOADER) << "--> No GpsData loaded!";
                 return false;
             }
+            else
+            {
+                ofLogNotice(Logger::DATA_LOADER) << "--> GpsData load ok!";
+                if (!cacheKeys.empty())
+                {
+                    GpsDataCache::save(cacheKeys[i], *gpsData);
+                }
+            }
 
-            ofLogNotice(Logger::DATA_LOADER) << "--> GpsData load ok!";
             ofLogNotice(Logger::DATA_LOADER)
                     << "--> Total data: "
-                    << gpsData->getSegments().size() << " GpsSegments, "
+                    << gpsData->getNumSegments() << " GpsSegments, "
                     << gpsData->getTotalGpsPoints() << " GpsPoints!"
                     << std::endl;
+            ofLogNotice(Logger::DATA_LOADER)
+                    << "--> Load time: " << jobs.loadTimes[i] << " ms";
 
             ofLogVerbose(Logger::DATA_LOADER)
                     << "minLon: " << gpsData->getMinUtmX() << ", "
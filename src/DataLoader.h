@@ -2,6 +2,8 @@
 #define DATALOADER_H
 
 #include "DrawingLifeIncludes.h"
+#include "Poco/Mutex.h"
+#include "Poco/Runnable.h"
 
 class DrawingLifeApp;
 class DBReader;
@@ -11,6 +13,8 @@ class DataLoader
 {
 public:
 
+    typedef boost::function<bool(DBReader*,GpsData&)> tFuncLoadGpsData;
+
     static bool loadGpsDataCity(DrawingLifeApp& app,
                                 const StringVec& names,
                                 const std::string& city);
@@ -31,9 +35,37 @@ private:
 
     static void processGpsData(DrawingLifeApp& app);
 
-    typedef boost::function<bool(DBReader*,GpsData&)> tFuncLoadGpsData;
+    /**
+     * \brief Load GpsData of all persons.
+     * \param funcVec query function per person.
+     * \param queries query description per person, used as cache key.
+     */
     static bool loadGpsData(DrawingLifeApp& app,
-                            const std::vector<tFuncLoadGpsData>& funcVec);
+                            const std::vector<tFuncLoadGpsData>& funcVec,
+                            const StringVec& queries);
+
+    /**
+     * \brief Persons to load and their results, shared by all workers.
+     */
+    struct GpsDataLoadJobs
+    {
+        GpsDataLoadJobs(const std::vector<tFuncLoadGpsData>& funcs,
+                        const GpsDataVector& datas)
+            : funcVec(funcs), gpsDatas(datas),
+              loadOk(datas.size(), 0), loadTimes(datas.size(), 0),
+              nextPerson(0) {}
+
+        bool next(size_t& personIndex);
+
+        const std::vector<tFuncLoadGpsData>& funcVec;
+        const GpsDataVector& gpsDatas;
+        std::vector<int> loadOk;
+        std::vector<unsigned long long> loadTimes;
+        size_t nextPerson;
+        Poco::FastMutex mutex;
+    };
+
+    class GpsDataLoadWorker;
 
 };
 
@@ -19,8 +19,10 @@
 
 //------------------------------------------------------------------------------
 
-DrawingLifeApp::DrawingLifeApp(std::string settingsFile) :
+DrawingLifeApp::DrawingLifeApp(std::string settingsFile,
+                               bool rebuildGpsDataCache) :
     m_settingsFile(settingsFile),
+    m_rebuildGpsDataCache(rebuildGpsDataCache),
     //m_settings(0),
     m_isFullscreen(false),
     m_isDebugMode(false),
@@ -47,10 +49,14 @@ DrawingLifeApp::DrawingLifeApp(std::string settingsFile) :
     m_loopMode(true),
     m_multiMode(false),
     m_multiModeInfo(false),
-    m_pause(false)
+    m_pause(false),
+    m_playbackTime(0.0)
 //    m_magicBox(0)
 {
     fnWalkDrawAll = boost::bind(&Walk::drawAll, _1);
+    fnWalkPrepareDraw = boost::bind(&Walk::prepareDraw, _1);
+    fnWalkDrawTrail = boost::bind(&Walk::drawTrail, _1);
+    fnWalkDrawOverlay = boost::bind(&Walk::drawOverlay, _1);
     fnWalkReset = boost::bind(&Walk::reset, _1);
     fnLocationImageDraw = boost::bind(&LocationImage::draw, _1);
 
@@ -61,6 +67,8 @@ DrawingLifeApp::DrawingLifeApp(std::string settingsFile) :
 
 DrawingLifeApp::~DrawingLifeApp()
 {
+    m_streamLoader.reset();
+
     m_gpsDatas.clear();
     m_walks.clear();
     m_magicBoxes.clear();
@@ -162,6 +170,7 @@ void DrawingLifeApp::setup()
     m_imageAsCurrentPoint = DataLoader::loadCurrentPointImages(*this);
 
     m_timeline.reset(new Timeline());
+    m_streamLoader.reset(new GpsDataStreamLoader(*m_settings));
 
     m_sqlFilePaths = m_settings->getSqlFilePaths();
 
@@ -195,15 +204,11 @@ void DrawingLifeApp::setup()
 
         if (gpsDataLoadOk)
         {
-            // GpsData are loaded now. Drawing routine can start.
-            for (size_t personIndex = 0; personIndex < m_numPersons; ++personIndex)
+            // GpsData are loaded now (or arrive while the animation runs).
+            // Drawing routine can start.
+            if (!m_streamLoader->isLoading() && hasEmptyGpsData())
             {
-                const GpsDataPtr gpsData = m_gpsDatas[personIndex];
-                if (gpsData->getTotalGpsPoints() == 0)
-                {
-                    m_startScreenMode = true;
-                    break;
-                }
+                m_startScreenMode = true;
             }
 
             DataLoader::loadLocationImages(*this);
@@ -271,13 +276,36 @@ void DrawingLifeApp::handleFirstTimelineObject()
 
 void DrawingLifeApp::update()
 {
+    if (m_streamLoader->isLoading())
+    {
+        m_streamLoader->update(*this);
+        if (!m_streamLoader->isLoading() && hasEmptyGpsData())
+        {
+            m_startScreenMode = true;
+        }
+    }
+
     if (m_isAnimation &&
         !m_pause &&
         !m_interactiveMode &&
-        m_timeline->getTimeline().size() > 0)
+        m_timeline->getTimeline().size() > 0 &&
+        m_settings->getPlaybackSpeed() > 0.0)
+    {
+        updatePlayback();
+    }
+    else if (m_isAnimation &&
+             !m_pause &&
+             !m_interactiveMode &&
+             m_timeline->getTimeline().size() > 0)
     {
         for (int i = 0; i < m_settings->getDrawSpeed(); ++i)
         {
+            // Wait for more data while streaming.
+            if (!m_timeline->hasCurrent())
+            {
+                break;
+            }
+
             handleFirstTimelineObject();
 
             const int id = m_timeline->getCurrentId();
@@ -352,24 +380,25 @@ void DrawingLifeApp::draw()
                     ViewHelper::drawInfo(*m_settings, *gpsData, walk,
                                          m_viewDimensions[i], m_fonts["info"], i);
                 }
+            }
 
-                // -----------------------------------------------------------------------------
-                // Draw Gps data
-                // -----------------------------------------------------------------------------
-                if (doShader)
-                {
-                    shaderBegin();
-                }
-                // ofSetColor(m_settings->getColorForegroundR(),
-                //            m_settings->getColorForegroundG(),
-                //            m_settings->getColorForegroundB(),
-                //            m_settings->getAlphaTrack());
-                ofNoFill();
-                walk.draw();
-                if (doShader)
-                {
-                    shaderEnd();
-                }
+            // -----------------------------------------------------------------------------
+            // Draw Gps data. Each pass for all persons, the trails of all
+            // persons are drawn with one bind of the track shader.
+            // -----------------------------------------------------------------------------
+            if (doShader)
+            {
+                shaderBegin();
+            }
+            ofNoFill();
+            std::for_each(m_walks.begin(), m_walks.end(), fnWalkPrepareDraw);
+            Walk::beginTrailBatch();
+            std::for_each(m_walks.begin(), m_walks.end(), fnWalkDrawTrail);
+            Walk::endTrailBatch();
+            std::for_each(m_walks.begin(), m_walks.end(), fnWalkDrawOverlay);
+            if (doShader)
+            {
+                shaderEnd();
             }
         }
 		// -----------------------------------------------------------------------------
@@ -387,7 +416,9 @@ void DrawingLifeApp::draw()
                        m_settings->getAlphaTrack());
             ofNoFill();
 
+            Walk::beginTrailBatch();
             std::for_each(m_walks.begin(), m_walks.end(), fnWalkDrawAll);
+            Walk::endTrailBatch();
         }
 
         if (m_showFps)
@@ -395,6 +426,12 @@ void DrawingLifeApp::draw()
             ViewHelper::drawFPS();
         }
 
+        if (m_streamLoader->isLoading())
+        {
+            ViewHelper::drawLoadingInfo(m_names,
+                                        m_streamLoader->getNumRowsLoaded());
+        }
+
         if (m_showKeyCommands)
         {
             const ofColor c(255, 255, 255, m_settings->getAlphaLegend());
@@ -672,17 +709,126 @@ void DrawingLifeApp::clearLocationImageVec()
 
 void DrawingLifeApp::resetData()
 {
+    if (m_streamLoader)
+    {
+        m_streamLoader->stop();
+    }
+
     m_startScreenMode = false;
+    m_playbackTime = 0.0;
 
     m_gpsDatas.clear();
     m_walks.clear();
     m_magicBoxes.clear();
 }
 
+//------------------------------------------------------------------------------
+
+void DrawingLifeApp::seekToTime(const tEpoch time)
+{
+    m_timeline->seekToTime(time);
+    seekWalks();
+}
+
+//------------------------------------------------------------------------------
+
+void DrawingLifeApp::seekToTimelineIndex(const unsigned int index)
+{
+    m_timeline->seekToIndex(index);
+    seekWalks();
+}
+
 //------------------------------------------------------------------------------
 // Private functions
 //------------------------------------------------------------------------------
 
+void DrawingLifeApp::updatePlayback()
+{
+    const TimelineObjectVec& timeline = m_timeline->getTimeline();
+
+    if (!m_timeline->hasCurrent())
+    {
+        if (!m_timeline->isComplete())
+        {
+            // Wait for more data while streaming.
+            return;
+        }
+
+        // Everything is shown.
+        if (!m_loopMode)
+        {
+            OF_EXIT_APP(0);
+        }
+        const int sleepTime = m_settings->getSleepTime();
+        if (sleepTime > 0)
+        {
+            sleepFunc(sleepTime);
+        }
+        m_timeline->seekToIndex(0);
+        std::for_each(m_walks.begin(), m_walks.end(), fnWalkReset);
+        m_playbackTime = 0.0;
+        return;
+    }
+
+    if (m_timeline->isFirst() && m_playbackTime < timeline.front().secs)
+    {
+        m_playbackTime = static_cast<double>(timeline.front().secs);
+    }
+
+    // Screen grabbing advances by whole frames, independent of render time.
+    const double frameTime = m_settings->getIsGrabScreen()
+            ? 1.0 / m_settings->getFrameRate() : ofGetLastFrameTime();
+    m_playbackTime += frameTime * m_settings->getPlaybackSpeed();
+    if (!m_timeline->isComplete())
+    {
+        // Don't run ahead of the loaded data.
+        m_playbackTime = std::min(m_playbackTime,
+                                  static_cast<double>(timeline.back().secs));
+    }
+
+    // Show every point up to the clock with one seek of all walks.
+    m_timeline->seekToTime(static_cast<tEpoch>(m_playbackTime) + 1);
+    seekWalks();
+
+    if (m_timeline->hasCurrent() && m_settings->isZoomAnimation())
+    {
+        m_zoomAnimation->update(m_magicBoxes);
+    }
+
+    if (m_settings->isSoundActive())
+    {
+        soundUpdate();
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void DrawingLifeApp::seekWalks()
+{
+    // Every walk continues with the point after its last one before the
+    // timeline counter.
+    for (size_t i = 0; i < m_walks.size(); ++i)
+    {
+        m_walks[i].seek(m_timeline->getNumPointsBefore(static_cast<int>(i)));
+    }
+}
+
+//------------------------------------------------------------------------------
+
+bool DrawingLifeApp::hasEmptyGpsData() const
+{
+    for (size_t personIndex = 0; personIndex < m_numPersons; ++personIndex)
+    {
+        if (m_gpsDatas[personIndex]->getTotalGpsPoints() == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+
 void DrawingLifeApp::soundUpdate()
 {
     if (!m_soundPlayers.empty())
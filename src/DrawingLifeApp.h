@@ -12,6 +12,7 @@
 #include "LocationImage.h"
 #include "Integrator.h"
 #include "ofSoundPlayer.h"
+#include "GpsDataStreamLoader.h"
 
 class ZoomAnimation;
 /**
@@ -21,7 +22,7 @@ class ZoomAnimation;
 class DrawingLifeApp : public ofBaseApp
 {
 public:
-	DrawingLifeApp(std::string settingsFile);
+	DrawingLifeApp(std::string settingsFile, bool rebuildGpsDataCache = false);
 	virtual ~DrawingLifeApp();
 	void setup();
 	void update();
@@ -40,6 +41,8 @@ public:
     GpsDataVector& getGpsDataVector() { return m_gpsDatas; }
     WalkVector& getWalkVector() { return m_walks; }
     MagicBoxVector& getMagicBoxVector() { return m_magicBoxes; }
+    GpsDataStreamLoader& getStreamLoader() { return *m_streamLoader; }
+    bool isRebuildGpsDataCache() const { return m_rebuildGpsDataCache; }
 
     const std::vector<CurrentPointImageData>& getCurrentPointImageList() const
     { return m_imageList; }
@@ -67,6 +70,16 @@ public:
 
     void resetData();
 
+    /**
+    * \brief Jump to a point in time without replaying the animation.
+    * \param time seconds since epoch.
+    */
+    void seekToTime(tEpoch time);
+    /**
+    * \brief Jump to a timeline index without replaying the animation.
+    */
+    void seekToTimelineIndex(unsigned int index);
+
     ViewDimensionsVec& getViewDimensionsVec() { return m_viewDimensions; }
     const ViewDimensionsVec& getViewDimensionsVec() const
     { return m_viewDimensions; }
@@ -83,10 +96,17 @@ private:
 
     void handleFirstTimelineObject();
 
+    void seekWalks();
+
+    void updatePlayback();
+
+    bool hasEmptyGpsData() const;
+
     //---------------------------------------------------------------------------
     // Member variables
     //---------------------------------------------------------------------------
     std::string m_settingsFile;
+    bool m_rebuildGpsDataCache;
 
     boost::scoped_ptr<AppSettings> m_settings;
 
@@ -113,6 +133,8 @@ private:
     // -----------------------------------------------------------------------------
     boost::shared_ptr<Timeline> m_timeline;
 
+    boost::scoped_ptr<GpsDataStreamLoader> m_streamLoader;
+
     DBQueryData m_dbQueryData;
 
     std::vector<CurrentPointImageData> m_imageList;
@@ -139,6 +161,9 @@ private:
 
     bool m_pause;
 
+    /// Gps time shown by the playback clock, see AppSettings::getPlaybackSpeed.
+    double m_playbackTime;
+
     ofSoundPlayerVec m_soundPlayers;
     ofSoundPlayerVec::iterator m_currentSoundPlayer;
 
@@ -150,6 +175,9 @@ private:
     bool doShader;
 
     boost::function<void(Walk&)> fnWalkDrawAll;
+    boost::function<void(Walk&)> fnWalkPrepareDraw;
+    boost::function<void(Walk&)> fnWalkDrawTrail;
+    boost::function<void(Walk&)> fnWalkDrawOverlay;
     boost::function<void(Walk&)> fnWalkReset;
     boost::function<void(LocationImage&)> fnLocationImageDraw;
 
@@ -5,6 +5,13 @@
 #ifndef _DRAWINGLIFETYPES_H_
 #define _DRAWINGLIFETYPES_H_
 
+#include <limits>
+
+//------------------------------------------------------------------------------
+
+/// Seconds since 1970-01-01 00:00:00 of a timestamp.
+typedef long long tEpoch;
+
 //------------------------------------------------------------------------------
 
 struct ZoomAnimFrame
@@ -13,20 +20,26 @@ struct ZoomAnimFrame
 	int frameZoom;
 	double frameCenterX;
 	double frameCenterY;
-	std::string timestamp;
+	tEpoch time;
 	int gpsId;
 
 };
 
 //------------------------------------------------------------------------------
 
+/**
+ * \brief One point in the timeline.
+ *
+ * Refers to the point in the GpsData of its person, 16 bytes per entry.
+ */
 struct TimelineObject
 {
-    std::string timeString;
-    time_t secs;
+    tEpoch secs;
+    /// Person index.
     int id;
-    int gpsid;
-    bool operator() (TimelineObject lhs, TimelineObject rhs)
+    /// Index of the point in all points of the person's GpsData.
+    unsigned int pointIndex;
+    bool operator() (const TimelineObject& lhs, const TimelineObject& rhs) const
     {
         return lhs.secs < rhs.secs;
     }
@@ -82,17 +95,6 @@ struct CurrentPointImageData
 
 //------------------------------------------------------------------------------
 
-struct GpsDataIndex
-{
-    GpsDataIndex(int p, int s, int n)
-        : gpsPoint(p), gpsSegment(s), numPoints(n) {}
-    int gpsPoint;
-    int gpsSegment;
-    int numPoints;
-};
-
-//------------------------------------------------------------------------------
-
 
 //------------------------------------------------------------------------------
 // templated version of openFramworks datatypes.
@@ -116,9 +118,86 @@ struct UtmPoint : public ofxPoint<double>
 {
     UtmPoint() : ofxPoint<double>(){}
     UtmPoint(double utmX, double utmY) : ofxPoint<double>(utmX, utmY) {}
-    double speed;
 };
 
+//------------------------------------------------------------------------------
+
+/**
+ * \brief Axis-aligned bounds of projected points.
+ *
+ * Comparisons are strict like MagicBox::isInBox(): if the bounds are inside
+ * a box all points are in it, if they don't intersect it none is.
+ */
+struct UtmBounds
+{
+    UtmBounds()
+    :
+    minUtm(std::numeric_limits<double>::max(),
+           std::numeric_limits<double>::max()),
+    maxUtm(-std::numeric_limits<double>::max(),
+           -std::numeric_limits<double>::max())
+    {}
+    UtmBounds(const UtmPoint& minPoint, const UtmPoint& maxPoint)
+    : minUtm(minPoint), maxUtm(maxPoint) {}
+
+    void add(const UtmPoint& utm)
+    {
+        minUtm.x = MIN(utm.x, minUtm.x);
+        minUtm.y = MIN(utm.y, minUtm.y);
+        maxUtm.x = MAX(utm.x, maxUtm.x);
+        maxUtm.y = MAX(utm.y, maxUtm.y);
+    }
+
+    void add(const UtmBounds& other)
+    {
+        add(other.minUtm);
+        add(other.maxUtm);
+    }
+
+    bool intersects(const UtmBounds& other) const
+    {
+        return minUtm.x < other.maxUtm.x && maxUtm.x > other.minUtm.x &&
+               minUtm.y < other.maxUtm.y && maxUtm.y > other.minUtm.y;
+    }
+
+    bool isInside(const UtmBounds& other) const
+    {
+        return minUtm.x > other.minUtm.x && maxUtm.x < other.maxUtm.x &&
+               minUtm.y > other.minUtm.y && maxUtm.y < other.maxUtm.y;
+    }
+
+    UtmPoint minUtm;
+    UtmPoint maxUtm;
+};
+
+//------------------------------------------------------------------------------
+
+/**
+ * \brief Read-only view on a contiguous part of an array, e.g. the points of
+ * one segment.
+ */
+template <typename T>
+class ArrayView
+{
+public:
+    typedef const T* iterator;
+    typedef const T* const_iterator;
+
+    ArrayView() : m_begin(0), m_size(0) {}
+    ArrayView(const T* begin, size_t size) : m_begin(begin), m_size(size) {}
+
+    const T& operator[](size_t index) const { return m_begin[index]; }
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    const_iterator begin() const { return m_begin; }
+    const_iterator end() const { return m_begin + m_size; }
+
+private:
+    const T* m_begin;
+    size_t m_size;
+};
+
+
 //------------------------------------------------------------------------------
 // typedefs
 //------------------------------------------------------------------------------
@@ -133,6 +212,10 @@ class LocationImage;
 class Timeline;
 
 typedef std::vector<std::string> StringVec;
+
+/// Location names by citydef id.
+typedef std::map<int, std::string> LocationMap;
+typedef boost::shared_ptr<const LocationMap> LocationMapPtr;
 typedef boost::scoped_ptr<DBReader> DBReaderPtr;
 typedef std::vector<ZoomAnimFrame> ZoomAnimFrameVec;
 
@@ -140,7 +223,6 @@ typedef boost::shared_ptr<GpsData> GpsDataPtr;
 typedef boost::weak_ptr<GpsData> GpsDataWeak;
 typedef std::vector<GpsDataPtr> GpsDataVector;
 
-typedef std::vector<GpsDataIndex> GpsDataIndexVector;
 
 typedef boost::ptr_vector<Walk> WalkVector;
 
@@ -150,6 +232,8 @@ typedef std::vector<MagicBoxPtr> MagicBoxVector;
 
 typedef std::vector<UtmPoint> UtmSegment;
 typedef std::vector<std::vector<UtmPoint> > UtmDataVector;
+typedef ArrayView<UtmPoint> UtmSegmentView;
+typedef std::vector<UtmBounds> UtmBoundsVector;
 typedef std::vector<GpsSegment> GpsSegmentVector;
 typedef std::vector<GpsPoint> GpsPointVector;
 
@@ -169,48 +253,6 @@ typedef boost::shared_ptr<Timeline> TimelinePtr;
 typedef boost::weak_ptr<Timeline> TimelineWeak;
 typedef std::vector<TimelineObject> TimelineObjectVec;
 
-class  ofVec2f;
-typedef std::vector<ofVec2f> tPoints;
-
-struct ColorSlice
-{
-    ColorSlice(const ofColor& c, const int startIndex)
-        : color(c), start(startIndex), total(1)
-    {
-        if (start > 0)
-        {
-            --start;
-            ++total;
-        }
-    }
-    ofColor color;
-    int start;
-    int total;
-};
-
-typedef std::vector<ColorSlice> tColorSlices;
-
-struct PointsAndColors
-{
-    tPoints points;
-    tColorSlices colors;
-
-    void add(const ofVec2f& pt, const ofColor& c)
-    {
-        points.push_back(pt);
-
-        if (colors.empty() || colors.back().color != c)
-        {
-            const int startIndex = static_cast<int>(points.size()) - 1;
-            colors.push_back(ColorSlice(c, startIndex));
-        }
-        else
-        {
-            ++colors.back().total;
-        }
-    }
-};
-
 //---------------------------------------------------------------------------
 
 #endif // _DRAWINGLIFETYPES_H_
@@ -4,10 +4,15 @@
 
 #include <proj_api.h>
 
-//------------------------------------------------------------------------------
+#include <cmath>
+
+#include "Poco/Environment.h"
+#include "Poco/Runnable.h"
+#include "Poco/Thread.h"
+#include "Poco/ThreadLocal.h"
+#include "Poco/ThreadPool.h"
 
-bool projInitialized = false;
-projPJ pjMerc, pjLonLat;
+//------------------------------------------------------------------------------
 
 static const char* projMercStr =
     "+proj=merc +a=6378137 +b=6378137 +lat_ts=0.0 +lon_0=0.0 +x_0=0.0 +y_0=0 +k=1.0 +units=m +nadgrids=@null +wktext  +no_defs";
@@ -17,28 +22,155 @@ static const char* projLonLatStr =
 
 //------------------------------------------------------------------------------
 
-void initProj()
+/**
+ * \brief A proj context with its own projections.
+ *
+ * proj objects must not be used by two threads at the same time, so the
+ * loader threads never share one.
+ */
+class ProjSet
 {
-    if (!projInitialized)
+public:
+    ProjSet()
+    {
+        ctx = pj_ctx_alloc();
+        merc = ctx ? pj_init_plus_ctx(ctx, projMercStr) : 0;
+        lonLat = ctx ? pj_init_plus_ctx(ctx, projLonLatStr) : 0;
+    }
+
+    ~ProjSet()
     {
-        pjMerc = pj_init_plus(projMercStr);
-        pjLonLat = pj_init_plus(projLonLatStr);
-        projInitialized = pjMerc && pjLonLat;
-        if (projInitialized)
+        if (merc) pj_free(merc);
+        if (lonLat) pj_free(lonLat);
+        if (ctx) pj_ctx_free(ctx);
+    }
+
+    bool isValid() const { return merc && lonLat; }
+
+    projCtx ctx;
+    projPJ merc;
+    projPJ lonLat;
+
+private:
+    ProjSet(const ProjSet&);
+    ProjSet& operator=(const ProjSet&);
+};
+
+//------------------------------------------------------------------------------
+
+/// Set by GeoUtils::init() before any loader thread starts, only read after.
+static bool projInitialized = false;
+
+/// Projections of the main thread, every Poco thread gets its own.
+static boost::scoped_ptr<ProjSet> mainProjSet;
+static Poco::ThreadLocal<ProjSet> threadProjSets;
+
+//------------------------------------------------------------------------------
+
+/**
+ * \brief The ProjSet of the calling thread, without locking.
+ */
+static const ProjSet& getProjSet()
+{
+    if (Poco::Thread::current() != 0)
+    {
+        return *threadProjSets;
+    }
+    if (!mainProjSet)
+    {
+        mainProjSet.reset(new ProjSet());
+    }
+    return *mainProjSet;
+}
+
+//------------------------------------------------------------------------------
+// Closed form of projMercStr: spherical mercator, no datum shift (@null).
+//------------------------------------------------------------------------------
+
+static const double MERCATOR_RADIUS = 6378137.0;
+
+/// Latitudes closer to the poles are not projectable, like in proj.
+static const double MERCATOR_MAX_LAT = 90.0 - 1e-10;
+
+/// Maximum difference in meters to proj for using the closed form.
+static const double MERCATOR_TOLERANCE = 1e-3;
+
+/// Set by GeoUtils::init() like projInitialized.
+static bool useFastMercator = false;
+
+//------------------------------------------------------------------------------
+
+/// Scalar loop, one std::sin and std::log per point. It saves the call
+/// overhead and datum handling of pj_transform, it is not vectorized.
+static void mercatorForward(const double* lons, const double* lats,
+                            const size_t count, UtmPoint* utmPoints)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (std::fabs(lats[i]) > MERCATOR_MAX_LAT)
+        {
+            utmPoints[i] = UtmPoint(0.0, 0.0);
+            continue;
+        }
+        const double sinLat = std::sin(lats[i] * DEG_TO_RAD);
+        utmPoints[i].x = MERCATOR_RADIUS * DEG_TO_RAD * lons[i];
+        utmPoints[i].y = MERCATOR_RADIUS * 0.5
+                * std::log((1.0 + sinLat) / (1.0 - sinLat));
+    }
+}
+
+//------------------------------------------------------------------------------
+
+static ofxPoint<double> mercatorInverse(const double x, const double y)
+{
+    return ofxPoint<double>(
+        x / MERCATOR_RADIUS * RAD_TO_DEG,
+        (2.0 * std::atan(std::exp(y / MERCATOR_RADIUS)) - HALF_PI) * RAD_TO_DEG);
+}
+
+//------------------------------------------------------------------------------
+
+/**
+ * \brief Compare the closed form with proj on a few points.
+ *
+ * Guards against projMercStr being changed without the closed form.
+ */
+static bool checkFastMercator(const ProjSet& proj)
+{
+    static const double samples[][2] = {
+        { 0.0, 0.0 }, { 13.44594, 52.49734 }, { -122.4194, 37.7749 },
+        { 151.2093, -33.8688 }, { 179.9, 85.0 }, { -179.9, -85.0 }
+    };
+    const size_t numSamples = sizeof(samples) / sizeof(samples[0]);
+    for (size_t i = 0; i < numSamples; ++i)
+    {
+        UtmPoint fast;
+        mercatorForward(&samples[i][0], &samples[i][1], 1, &fast);
+
+        double x = samples[i][0] * DEG_TO_RAD;
+        double y = samples[i][1] * DEG_TO_RAD;
+        if (pj_transform(proj.lonLat, proj.merc, 1, 1, &x, &y, NULL) != 0 ||
+            std::fabs(fast.x - x) > MERCATOR_TOLERANCE ||
+            std::fabs(fast.y - y) > MERCATOR_TOLERANCE)
         {
-            ofLogVerbose() << "Proj4 version: " << PJ_VERSION;
+            return false;
         }
-        else
+
+        const ofxPoint<double> lonLat = mercatorInverse(x, y);
+        if (std::fabs(lonLat.x - samples[i][0]) > 1e-8 ||
+            std::fabs(lonLat.y - samples[i][1]) > 1e-8)
         {
-            ofLogError() << "Could not initialize Proj4!";
-            ofExit(1);
+            return false;
         }
     }
+    return true;
 }
 
 //------------------------------------------------------------------------------
 
-void transformPoint(projPJ& src, projPJ& dst, double& x, double& y)
+//------------------------------------------------------------------------------
+
+void transformPoint(projPJ src, projPJ dst, double& x, double& y)
 {
     const int pjErrno = pj_transform(src, dst, 1, 1, &x, &y, NULL);
 
@@ -51,23 +183,192 @@ void transformPoint(projPJ& src, projPJ& dst, double& x, double& y)
 
 //------------------------------------------------------------------------------
 
+/// Points per pj_transform call.
+static const size_t BATCH_CHUNK_SIZE = 4096;
+
+/// Inputs smaller than this are projected on the calling thread.
+static const size_t BATCH_MIN_POINTS_PER_THREAD = 100000;
+
+//------------------------------------------------------------------------------
+
+static void transformBatch(const double* lons, const double* lats,
+                           const size_t count, UtmPoint* utmPoints)
+{
+    const ProjSet& proj = getProjSet();
+    if (!proj.isValid())
+    {
+        ofLogError() << "Could not initialize Proj4 for thread!";
+        std::fill(utmPoints, utmPoints + count, UtmPoint(0.0, 0.0));
+        return;
+    }
+    const projPJ src = proj.lonLat;
+    const projPJ dst = proj.merc;
+
+    double x[BATCH_CHUNK_SIZE];
+    double y[BATCH_CHUNK_SIZE];
+    for (size_t start = 0; start < count; start += BATCH_CHUNK_SIZE)
+    {
+        const size_t num = std::min(BATCH_CHUNK_SIZE, count - start);
+        for (size_t i = 0; i < num; ++i)
+        {
+            x[i] = lons[start + i] * DEG_TO_RAD;
+            y[i] = lats[start + i] * DEG_TO_RAD;
+        }
+        const int pjErrno = pj_transform(src, dst, static_cast<long>(num), 1,
+                                         x, y, NULL);
+        if (pjErrno != 0)
+        {
+            // A single bad point fails the whole call, redo the chunk point
+            // by point so that only the bad ones end up at 0/0.
+            for (size_t i = 0; i < num; ++i)
+            {
+                x[i] = lons[start + i] * DEG_TO_RAD;
+                y[i] = lats[start + i] * DEG_TO_RAD;
+                transformPoint(src, dst, x[i], y[i]);
+            }
+        }
+        for (size_t i = 0; i < num; ++i)
+        {
+            utmPoints[start + i] = UtmPoint(x[i], y[i]);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+/**
+ * \brief Projects one slice of a batch with its own ProjSet.
+ */
+class ProjectionWorker : public Poco::Runnable
+{
+public:
+    ProjectionWorker(const double* lons, const double* lats,
+                     size_t count, UtmPoint* utmPoints)
+        : m_lons(lons), m_lats(lats), m_count(count), m_utmPoints(utmPoints) {}
+
+    void run()
+    {
+        transformBatch(m_lons, m_lats, m_count, m_utmPoints);
+    }
+
+private:
+    const double* m_lons;
+    const double* m_lats;
+    size_t m_count;
+    UtmPoint* m_utmPoints;
+};
+
+//------------------------------------------------------------------------------
+
+static size_t getNumProjectionThreads()
+{
+    return std::max<size_t>(1, Poco::Environment::processorCount());
+}
+
+//------------------------------------------------------------------------------
+
+/**
+ * \brief Threads for splitting batches, created once and only used from
+ * the main thread.
+ */
+static Poco::ThreadPool& getProjectionThreadPool()
+{
+    static Poco::ThreadPool threadPool(
+        1, static_cast<int>(getNumProjectionThreads()));
+    return threadPool;
+}
+
+//------------------------------------------------------------------------------
+
+void GeoUtils::init()
+{
+    if (projInitialized)
+    {
+        return;
+    }
+    const ProjSet& proj = getProjSet();
+    if (!proj.isValid())
+    {
+        ofLogError() << "Could not initialize Proj4!";
+        ofExit(1);
+        return;
+    }
+    ofLogVerbose() << "Proj4 version: " << PJ_VERSION;
+    useFastMercator = checkFastMercator(proj);
+    ofLogVerbose() << "Mercator projection: "
+                   << (useFastMercator ? "closed form" : "proj4");
+    projInitialized = true;
+}
+
+//------------------------------------------------------------------------------
+
 UtmPoint GeoUtils::LonLat2Utm(const double lon, const double lat)
 {
-    initProj();
-    double x = lon * DEG_TO_RAD;
-    double y = lat * DEG_TO_RAD;
-    transformPoint(pjLonLat, pjMerc, x, y);
-    return UtmPoint(x, y);
+    if (useFastMercator)
+    {
+        UtmPoint utmPoint;
+        mercatorForward(&lon, &lat, 1, &utmPoint);
+        return utmPoint;
+    }
+    UtmPoint utmPoint;
+    transformBatch(&lon, &lat, 1, &utmPoint);
+    return utmPoint;
+}
+
+//------------------------------------------------------------------------------
+
+void GeoUtils::LonLat2UtmBatch(const double* lons, const double* lats,
+                               const size_t count, UtmPoint* utmPoints)
+{
+    if (useFastMercator)
+    {
+        mercatorForward(lons, lats, count, utmPoints);
+        return;
+    }
+
+    // The loaders already project on one thread per person, only a batch of
+    // the main thread is split.
+    const bool isWorkerThread = Poco::Thread::current() != 0;
+    const size_t numThreads = isWorkerThread ? 1 : std::min<size_t>(
+        getNumProjectionThreads(), count / BATCH_MIN_POINTS_PER_THREAD);
+    if (numThreads <= 1)
+    {
+        transformBatch(lons, lats, count, utmPoints);
+        return;
+    }
+
+    boost::ptr_vector<ProjectionWorker> workers;
+    Poco::ThreadPool& threadPool = getProjectionThreadPool();
+    const size_t slice = (count + numThreads - 1) / numThreads;
+    for (size_t start = 0; start < count; start += slice)
+    {
+        const size_t num = std::min(slice, count - start);
+        workers.push_back(new ProjectionWorker(lons + start, lats + start,
+                                               num, utmPoints + start));
+        threadPool.start(workers.back());
+    }
+    threadPool.joinAll();
 }
 
 //------------------------------------------------------------------------------
 
 ofxPoint<double> GeoUtils::Utm2LonLat(const double x, const double y)
 {
-    initProj();
+    if (useFastMercator)
+    {
+        return mercatorInverse(x, y);
+    }
     double lon = x;
     double lat = y;
-    transformPoint(pjMerc, pjLonLat, lon, lat);
+    const ProjSet& proj = getProjSet();
+    if (proj.isValid())
+    {
+        transformPoint(proj.merc, proj.lonLat, lon, lat);
+    }
+    else
+    {
+        lon = lat = 0.0;
+    }
     return ofxPoint<double>(lon * RAD_TO_DEG, lat * RAD_TO_DEG);
 }
 
@@ -14,7 +14,26 @@
 class GeoUtils
 {
 public:
+    /**
+    * \brief Set up the projection, call on the main thread before any
+    * other thread projects.
+    */
+    static void init();
     static UtmPoint LonLat2Utm(double lon, double lat);
+    /**
+    * \brief Project many points at once.
+    *
+    * Points are transformed in chunks with one pj_transform call each.
+    * Large inputs of the main thread are split across all cores, every
+    * thread with its own proj context. On other threads, e.g. the loaders,
+    * the points are projected on the calling thread.
+    * \param lons longitudes in degrees.
+    * \param lats latitudes in degrees.
+    * \param count number of points.
+    * \param utmPoints output array for count points.
+    */
+    static void LonLat2UtmBatch(const double* lons, const double* lats,
+                                size_t count, UtmPoint* utmPoints);
     static ofxPoint<double> Utm2LonLat(double x, double y);
 };
 
@@ -15,17 +15,20 @@ m_user(""),
 m_minLonLat(0.0, 0.0),
 m_maxLonLat(0.0, 0.0),
 m_minUtm(0.0, 0.0),
-m_maxUtm(0.0, 0.0)
+m_maxUtm(0.0, 0.0),
+m_minUtmData(Utils::getPointDoubleMax()),
+m_maxUtmData(Utils::getPointDoubleMin()),
+m_segmentOffsets(1, 0),
+m_chunkOffsets(1, 0),
+m_lodIndices(NUM_LOD_LEVELS),
+m_lodOffsets(NUM_LOD_LEVELS, std::vector<size_t>(1, 0))
 {
-	m_segments.reserve(1000); // TODO good amount.
+}
 
-    fnGetLongitude = boost::bind(&GpsPoint::getLongitude, _1);
-    fnGetLatitude = boost::bind(&GpsPoint::getLatitude, _1);
-    fnGetElevation = boost::bind(&GpsPoint::getElevation, _1);
+//------------------------------------------------------------------------------
 
-    fnGetUtmX = boost::bind(&UtmPoint::x, _1);
-    fnGetUtmY = boost::bind(&UtmPoint::y, _1);
-}
+const size_t GpsData::BOUNDS_CHUNK_SIZE;
+const size_t GpsData::NUM_LOD_LEVELS;
 
 //------------------------------------------------------------------------------
 
@@ -41,19 +44,79 @@ GpsData::~GpsData()
 void GpsData::setGpsData(const GpsSegmentVector& segments,
                          const ofxPoint<double>& minLonLat,
                          const ofxPoint<double>& maxLonLat,
-                         const std::string& user)
+                         const std::string& user,
+                         const LocationMapPtr& locations)
 {
+    clear();
 	++m_gpsDataId;
-	m_segments.clear();
-	m_segments = segments;
     m_minLonLat = minLonLat;
     m_maxLonLat = maxLonLat;
     // -------------------------------------------------------------------------
     m_minUtm = GeoUtils::LonLat2Utm(m_minLonLat.x, m_minLonLat.y);
     m_maxUtm = GeoUtils::LonLat2Utm(m_maxLonLat.x, m_maxLonLat.y);
     m_user = user;
-    calculateUtmPointsWithIndex();
-    normalizeUtmPoints();
+    m_locations = locations;
+
+    UtmDataVector utmSegments;
+    const unsigned long long projectStart = ofGetElapsedTimeMillis();
+    calculateUtmPoints(segments, utmSegments);
+    ofLogVerbose(Logger::GPS_DATA)
+            << "Projection time: " << ofGetElapsedTimeMillis() - projectStart
+            << " ms";
+    LodLevels lod;
+    calculateLod(utmSegments, lod);
+    appendSegments(segments, utmSegments);
+
+    setMinMaxValuesUTM(0);
+    setMinMaxRatioUTM();
+    appendBounds(0);
+    appendLod(lod, 0, false);
+}
+
+//------------------------------------------------------------------------------
+
+void GpsData::addGpsData(const GpsSegmentVector& segments,
+                         const UtmDataVector& utmSegments,
+                         const LodLevels& lod,
+                         const ofxPoint<double>& minLonLat,
+                         const ofxPoint<double>& maxLonLat,
+                         const std::string& user,
+                         const LocationMapPtr& locations)
+{
+    if (segments.empty())
+    {
+        return;
+    }
+
+    const size_t segmentStart = getNumSegments();
+    const size_t pointStart = m_ids.size();
+    if (segmentStart == 0)
+    {
+        ++m_gpsDataId;
+        m_minLonLat = minLonLat;
+        m_maxLonLat = maxLonLat;
+    }
+    else
+    {
+        m_minLonLat.x = MIN(minLonLat.x, m_minLonLat.x);
+        m_minLonLat.y = MIN(minLonLat.y, m_minLonLat.y);
+        m_maxLonLat.x = MAX(maxLonLat.x, m_maxLonLat.x);
+        m_maxLonLat.y = MAX(maxLonLat.y, m_maxLonLat.y);
+    }
+    m_user = user;
+    m_locations = locations;
+
+    const bool isContinued = segmentStart > 0 &&
+        segments.front().getSegmentNum() == m_segmentNums.back();
+    appendSegments(segments, utmSegments, isContinued);
+
+    // Only the new points have to be checked, normalized values are
+    // calculated on demand. Bounds and levels of a continued segment are
+    // updated.
+    setMinMaxValuesUTM(pointStart);
+    setMinMaxRatioUTM();
+    appendBounds(isContinued ? segmentStart - 1 : segmentStart);
+    appendLod(lod, pointStart, isContinued);
 }
 
 //------------------------------------------------------------------------------
@@ -61,30 +124,150 @@ void GpsData::setGpsData(const GpsSegmentVector& segments,
 void GpsData::clear()
 {
     m_gpsDataId = 0;
-    m_segments.clear();
     m_minLonLat = ofxPoint<double>(0.0, 0.0);
     m_maxLonLat = ofxPoint<double>(0.0, 0.0);
     m_minUtm = ofxPoint<double>(0.0, 0.0);
     m_maxUtm = ofxPoint<double>(0.0, 0.0);
+    m_minUtmData = Utils::getPointDoubleMax();
+    m_maxUtmData = Utils::getPointDoubleMin();
     m_user = std::string();
+
+    m_latitudes.clear();
+    m_longitudes.clear();
+    m_elevations.clear();
+    m_speeds.clear();
+    m_times.clear();
+    m_ids.clear();
+    m_locationIds.clear();
+    m_utmPoints.clear();
+    m_segmentOffsets.assign(1, 0);
+    m_segmentNums.clear();
+    m_segmentBounds.clear();
+    m_chunkBounds.clear();
+    m_chunkOffsets.assign(1, 0);
+    m_lodIndices.assign(NUM_LOD_LEVELS, std::vector<unsigned int>());
+    m_lodOffsets.assign(NUM_LOD_LEVELS, std::vector<size_t>(1, 0));
+    m_locations.reset();
+
+}
+
+//------------------------------------------------------------------------------
+
+void GpsData::appendSegments(const GpsSegmentVector& segments,
+                             const UtmDataVector& utmSegments,
+                             const bool isContinued)
+{
+    size_t numPoints = m_ids.size();
+    BOOST_FOREACH(const GpsSegment& segment, segments)
+    {
+        numPoints += segment.getPoints().size();
+    }
+    m_latitudes.reserve(numPoints);
+    m_longitudes.reserve(numPoints);
+    m_elevations.reserve(numPoints);
+    m_speeds.reserve(numPoints);
+    m_times.reserve(numPoints);
+    m_ids.reserve(numPoints);
+    m_locationIds.reserve(numPoints);
+    m_utmPoints.reserve(numPoints);
+
+    for (size_t i = 0; i < segments.size(); ++i)
+    {
+        const GpsPointVector& points = segments[i].getPoints();
+        const UtmSegment& utmSegment = utmSegments[i];
+        for (size_t j = 0; j < points.size(); ++j)
+        {
+            const GpsPoint& point = points[j];
+            m_latitudes.push_back(point.getLatitude());
+            m_longitudes.push_back(point.getLongitude());
+            m_elevations.push_back(point.getElevation());
+            m_speeds.push_back(point.getSpeed());
+            m_times.push_back(point.getTime());
+            m_ids.push_back(point.getGpsPointId());
+            m_locationIds.push_back(point.getLocationId());
+            m_utmPoints.push_back(utmSegment[j]);
+        }
+        if (i == 0 && isContinued)
+        {
+            m_segmentOffsets.back() = m_ids.size();
+        }
+        else
+        {
+            m_segmentNums.push_back(segments[i].getSegmentNum());
+            m_segmentOffsets.push_back(m_ids.size());
+        }
+    }
 }
 
 //------------------------------------------------------------------------------
 // Getters
 //------------------------------------------------------------------------------
 
-double GpsData::getData(const size_t segmentIndex, const size_t pointIndex,
-                        const tFnGetGpsData& fnGetGpsData) const
+bool GpsData::getPointIndex(const size_t segmentIndex,
+                            const size_t pointIndex,
+                            size_t& index) const
+{
+    if (segmentIndex >= getNumSegments())
+    {
+        return false;
+    }
+    const size_t segmentBegin = m_segmentOffsets[segmentIndex];
+    if (pointIndex >= m_segmentOffsets[segmentIndex + 1] - segmentBegin)
+    {
+        return false;
+    }
+    index = segmentBegin + pointIndex;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+bool GpsData::getSegmentAndPoint(const size_t index,
+                                 size_t& segmentIndex,
+                                 size_t& pointIndex) const
+{
+    if (index >= m_ids.size())
+    {
+        return false;
+    }
+    // Last segment starting at or before index, skips empty segments.
+    const std::vector<size_t>::const_iterator it =
+        std::upper_bound(m_segmentOffsets.begin(), m_segmentOffsets.end(),
+                         index) - 1;
+    segmentIndex = it - m_segmentOffsets.begin();
+    pointIndex = index - *it;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+size_t GpsData::getNumPoints(const size_t segmentIndex) const
+{
+    if (segmentIndex >= getNumSegments())
+    {
+        return 0;
+    }
+    return m_segmentOffsets[segmentIndex + 1] - m_segmentOffsets[segmentIndex];
+}
+
+//------------------------------------------------------------------------------
+
+size_t GpsData::getSegmentOffset(const size_t segmentIndex) const
+{
+    return m_segmentOffsets[std::min(segmentIndex, getNumSegments())];
+}
+
+//------------------------------------------------------------------------------
+
+int GpsData::getSegmentNum(const size_t segmentIndex) const
 {
     try
     {
-        const GpsPointVector& points = m_segments.at(segmentIndex).getPoints();
-        const GpsPoint point = points.at(pointIndex);
-        return fnGetGpsData(point);
+        return m_segmentNums.at(segmentIndex);
     }
     catch (const std::out_of_range&)
     {
-        return -1000.0;
+        return 0;
     }
 }
 
@@ -93,7 +276,9 @@ double GpsData::getData(const size_t segmentIndex, const size_t pointIndex,
 double GpsData::getLongitude(const size_t segmentIndex,
                              const size_t pointIndex) const
 {
-    return getData(segmentIndex, pointIndex, fnGetLongitude);
+    size_t index;
+    return getPointIndex(segmentIndex, pointIndex, index)
+            ? m_longitudes[index] : -1000.0;
 }
 
 //------------------------------------------------------------------------------
@@ -101,7 +286,9 @@ double GpsData::getLongitude(const size_t segmentIndex,
 double GpsData::getLatitude(const size_t segmentIndex,
                             const size_t pointIndex) const
 {
-    return getData(segmentIndex, pointIndex, fnGetLatitude);
+    size_t index;
+    return getPointIndex(segmentIndex, pointIndex, index)
+            ? m_latitudes[index] : -1000.0;
 }
 
 //------------------------------------------------------------------------------
@@ -109,25 +296,49 @@ double GpsData::getLatitude(const size_t segmentIndex,
 double GpsData::getElevation(const size_t segmentIndex,
                              const size_t pointIndex) const
 {
-    return getData(segmentIndex, pointIndex, fnGetElevation);
+    size_t index;
+    return getPointIndex(segmentIndex, pointIndex, index)
+            ? m_elevations[index] : -1000.0;
 }
 
 //------------------------------------------------------------------------------
 
-double GpsData::getUtmData(size_t segmentIndex, size_t pointIndex,
-                           const UtmDataVector& utmVec,
-                           const tFnGetUtmData& fnGetUtmData) const
+double GpsData::getSpeed(const size_t segmentIndex,
+                         const size_t pointIndex) const
 {
-    try
-    {
-        const UtmSegment& utmSegment = utmVec.at(segmentIndex);
-        const UtmPoint&  utmPoint = utmSegment.at(pointIndex);
-        return fnGetUtmData(utmPoint);
-    }
-    catch (const std::out_of_range&)
-    {
-        return 0.0;
-    }
+    size_t index;
+    return getPointIndex(segmentIndex, pointIndex, index)
+            ? m_speeds[index] : 0.0;
+}
+
+//------------------------------------------------------------------------------
+
+tEpoch GpsData::getTime(const size_t segmentIndex,
+                        const size_t pointIndex) const
+{
+    size_t index;
+    return getPointIndex(segmentIndex, pointIndex, index)
+            ? m_times[index] : 0;
+}
+
+//------------------------------------------------------------------------------
+
+const std::string GpsData::getTimestamp(const size_t segmentIndex,
+                                        const size_t pointIndex) const
+{
+    size_t index;
+    return getPointIndex(segmentIndex, pointIndex, index)
+            ? Utils::epochToTimestamp(m_times[index]) : std::string();
+}
+
+//------------------------------------------------------------------------------
+
+int GpsData::getGpsPointId(const size_t segmentIndex,
+                           const size_t pointIndex) const
+{
+    size_t index;
+    return getPointIndex(segmentIndex, pointIndex, index)
+            ? m_ids[index] : 0;
 }
 
 //------------------------------------------------------------------------------
@@ -135,7 +346,7 @@ double GpsData::getUtmData(size_t segmentIndex, size_t pointIndex,
 double GpsData::getUtmX(const size_t segmentIndex,
                         const size_t pointIndex) const
 {
-    return getUtmData(segmentIndex, pointIndex, m_utmPoints, fnGetUtmX);
+    return getUtm(segmentIndex, pointIndex).x;
 }
 
 //------------------------------------------------------------------------------
@@ -143,7 +354,7 @@ double GpsData::getUtmX(const size_t segmentIndex,
 double GpsData::getUtmY(const size_t segmentIndex,
                         const size_t pointIndex) const
 {
-    return getUtmData(segmentIndex, pointIndex, m_utmPoints, fnGetUtmY);
+    return getUtm(segmentIndex, pointIndex).y;
 }
 
 //------------------------------------------------------------------------------
@@ -151,15 +362,9 @@ double GpsData::getUtmY(const size_t segmentIndex,
 UtmPoint GpsData::getUtm(const size_t segmentIndex,
                          const size_t pointIndex) const
 {
-    try
-    {
-        const UtmSegment& utmSegment = m_utmPoints.at(segmentIndex);
-        return utmSegment.at(pointIndex);
-    }
-    catch (const std::out_of_range&)
-    {
-        return UtmPoint();
-    }
+    size_t index;
+    return getPointIndex(segmentIndex, pointIndex, index)
+            ? m_utmPoints[index] : UtmPoint();
 }
 
 //------------------------------------------------------------------------------
@@ -167,7 +372,7 @@ UtmPoint GpsData::getUtm(const size_t segmentIndex,
 double GpsData::getNormalizedUtmX(const size_t segmentIndex,
                                   const size_t pointIndex) const
 {
-    return getUtmData(segmentIndex, pointIndex, m_normalizedUtmPoints, fnGetUtmX);
+    return getNormalizedUtm(segmentIndex, pointIndex).x;
 }
 
 //------------------------------------------------------------------------------
@@ -175,7 +380,7 @@ double GpsData::getNormalizedUtmX(const size_t segmentIndex,
 double GpsData::getNormalizedUtmY(const size_t segmentIndex,
                                   const size_t pointIndex) const
 {
-    return getUtmData(segmentIndex, pointIndex, m_normalizedUtmPoints, fnGetUtmY);
+    return getNormalizedUtm(segmentIndex, pointIndex).y;
 }
 
 //------------------------------------------------------------------------------
@@ -183,15 +388,14 @@ double GpsData::getNormalizedUtmY(const size_t segmentIndex,
 UtmPoint GpsData::getNormalizedUtm(const size_t segmentIndex,
                                    const size_t pointIndex) const
 {
-    try
-    {
-        const UtmSegment& normUtmSeg = m_normalizedUtmPoints.at(segmentIndex);
-        return normUtmSeg.at(pointIndex);
-    }
-    catch (const std::out_of_range&)
+    size_t index;
+    if (!getPointIndex(segmentIndex, pointIndex, index))
     {
         return UtmPoint();
     }
+    const UtmPoint& utmPoint = m_utmPoints[index];
+    return UtmPoint((utmPoint.x - m_minUtm.x) / (m_maxUtm.x - m_minUtm.x),
+                    (utmPoint.y - m_minUtm.y) / (m_maxUtm.y - m_minUtm.y));
 }
 
 //------------------------------------------------------------------------------
@@ -199,93 +403,189 @@ UtmPoint GpsData::getNormalizedUtm(const size_t segmentIndex,
 const std::string GpsData::getGpsLocation(const size_t segmentIndex,
                                           const size_t pointIndex) const
 {
-    try
+    size_t index;
+    if (!m_locations || !getPointIndex(segmentIndex, pointIndex, index))
     {
-        const GpsPointVector& points = m_segments.at(segmentIndex).getPoints();
-        return points.at(pointIndex).getLocation();
+        return std::string();
     }
-    catch (const std::out_of_range&)
+    const LocationMap::const_iterator it = m_locations->find(m_locationIds[index]);
+    return it != m_locations->end() ? it->second : std::string();
+}
+
+//------------------------------------------------------------------------------
+
+UtmSegmentView GpsData::getUtmSegment(const size_t segmentIndex) const
+{
+    const size_t numPoints = getNumPoints(segmentIndex);
+    if (numPoints == 0)
     {
-        return std::string();
+        return UtmSegmentView();
     }
+    return UtmSegmentView(&m_utmPoints[m_segmentOffsets[segmentIndex]],
+                          numPoints);
 }
 
 //------------------------------------------------------------------------------
 
-int GpsData::getTotalGpsPoints() const
+ArrayView<double> GpsData::getSpeedSegment(const size_t segmentIndex) const
 {
-	int num = 0;
-    BOOST_FOREACH(const GpsSegment& rSegment, m_segments)
+    const size_t numPoints = getNumPoints(segmentIndex);
+    if (numPoints == 0)
     {
-        num += rSegment.getPoints().size();
+        return ArrayView<double>();
     }
-	return num;
+    return ArrayView<double>(&m_speeds[m_segmentOffsets[segmentIndex]],
+                             numPoints);
 }
 
 //------------------------------------------------------------------------------
 
-GpsPoint GpsData::getGpsPoint(const ofxPoint<double>& utmP)
+UtmSegmentView GpsData::getUtmPoints() const
 {
-    GpsPoint p;
-    ofxPoint<double> latLon = GeoUtils::Utm2LonLat(utmP.x, utmP.y);
-    p.setDataFromLatLon(latLon.y, latLon.x);
+    return m_utmPoints.empty()
+            ? UtmSegmentView()
+            : UtmSegmentView(&m_utmPoints[0], m_utmPoints.size());
+}
 
-    return p;
+//------------------------------------------------------------------------------
+
+ArrayView<double> GpsData::getSpeeds() const
+{
+    return m_speeds.empty() ? ArrayView<double>()
+                            : ArrayView<double>(&m_speeds[0], m_speeds.size());
 }
 
 //------------------------------------------------------------------------------
 
-void GpsData::calculateUtmPointsWithIndex()
+const UtmBounds& GpsData::getSegmentBounds(const size_t segmentIndex) const
 {
-    m_indices.clear();
-    int numAllPoints = 0;
-    m_utmPoints.clear();
-    m_utmPoints.reserve(m_segments.size());
+    static const UtmBounds emptyBounds;
+    return segmentIndex < m_segmentBounds.size()
+            ? m_segmentBounds[segmentIndex] : emptyBounds;
+}
 
-    int indexSegment = 0;
-    BOOST_FOREACH(const GpsSegment& segment, m_segments)
+//------------------------------------------------------------------------------
+
+ArrayView<UtmBounds> GpsData::getChunkBounds(const size_t segmentIndex) const
+{
+    if (segmentIndex >= getNumSegments())
     {
-        int indexPoint = 0;
-        std::vector<UtmPoint> utmVec;
-        utmVec.reserve(segment.getPoints().size());
-        BOOST_FOREACH(const GpsPoint& point, segment.getPoints())
-        {
-            UtmPoint utmP = GeoUtils::LonLat2Utm(point.getLongitude(),
-                                                 point.getLatitude());
-            utmP.speed = point.getSpeed();
+        return ArrayView<UtmBounds>();
+    }
+    const size_t chunkBegin = m_chunkOffsets[segmentIndex];
+    const size_t numChunks = m_chunkOffsets[segmentIndex + 1] - chunkBegin;
+    return numChunks == 0
+            ? ArrayView<UtmBounds>()
+            : ArrayView<UtmBounds>(&m_chunkBounds[chunkBegin], numChunks);
+}
 
-            utmVec.push_back(utmP);
+//------------------------------------------------------------------------------
 
-            GpsDataIndex idx(indexPoint++, indexSegment, numAllPoints++);
-            m_indices.push_back(idx);
-        }
-        m_utmPoints.push_back(utmVec);
-        ++indexSegment;
+ArrayView<unsigned int> GpsData::getLodIndices(const size_t level) const
+{
+    if (level == 0 || level >= NUM_LOD_LEVELS || m_lodIndices[level].empty())
+    {
+        return ArrayView<unsigned int>();
     }
+    const std::vector<unsigned int>& indices = m_lodIndices[level];
+    return ArrayView<unsigned int>(&indices[0], indices.size());
 }
 
 //------------------------------------------------------------------------------
-// Normalize Utm points.
+
+size_t GpsData::getLodSegmentOffset(const size_t level,
+                                    const size_t segmentIndex) const
+{
+    if (level == 0 || level >= NUM_LOD_LEVELS)
+    {
+        return getSegmentOffset(segmentIndex);
+    }
+    const std::vector<size_t>& offsets = m_lodOffsets[level];
+    return offsets[std::min(segmentIndex, offsets.size() - 1)];
+}
+
 //------------------------------------------------------------------------------
 
-void GpsData::normalizeUtmPoints()
+/// Tolerance of the simplification from one level to the next, 1 m for
+/// level 1, four times more for each level above.
+static double getLodStepTolerance(const size_t level)
 {
-    setMinMaxRatioUTM();
+    return level == 0 ? 0.0 : std::ldexp(1.0, 2 * (static_cast<int>(level) - 1));
+}
+
+//------------------------------------------------------------------------------
+
+double GpsData::getLodTolerance(const size_t level)
+{
+    // Every level is simplified from the one below, the errors of all
+    // steps add up: sum of 4^(k - 1) for k = 1..level.
+    return (std::ldexp(1.0, 2 * static_cast<int>(level)) - 1.0) / 3.0;
+}
+
+//------------------------------------------------------------------------------
 
-    m_normalizedUtmPoints.clear();
-    BOOST_FOREACH(const UtmSegment& utmSegment, m_utmPoints)
+ArrayView<tEpoch> GpsData::getTimes() const
+{
+    return m_times.empty() ? ArrayView<tEpoch>()
+                           : ArrayView<tEpoch>(&m_times[0], m_times.size());
+}
+
+//------------------------------------------------------------------------------
+
+ArrayView<int> GpsData::getGpsPointIds() const
+{
+    return m_ids.empty() ? ArrayView<int>()
+                         : ArrayView<int>(&m_ids[0], m_ids.size());
+}
+
+//------------------------------------------------------------------------------
+
+GpsPoint GpsData::getGpsPoint(const ofxPoint<double>& utmP)
+{
+    GpsPoint p;
+    ofxPoint<double> latLon = GeoUtils::Utm2LonLat(utmP.x, utmP.y);
+    p.setDataFromLatLon(latLon.y, latLon.x);
+
+    return p;
+}
+
+//------------------------------------------------------------------------------
+
+void GpsData::calculateUtmPoints(const GpsSegmentVector& segments,
+                                 UtmDataVector& utmPoints)
+{
+    // Gather all coordinates so that they are projected in one batch.
+    size_t numPoints = 0;
+    BOOST_FOREACH(const GpsSegment& segment, segments)
     {
-        UtmSegment normalizedSegments;
-        BOOST_FOREACH(const UtmPoint& utmPoint, utmSegment)
+        numPoints += segment.getPoints().size();
+    }
+    std::vector<double> lons;
+    std::vector<double> lats;
+    lons.reserve(numPoints);
+    lats.reserve(numPoints);
+    BOOST_FOREACH(const GpsSegment& segment, segments)
+    {
+        BOOST_FOREACH(const GpsPoint& point, segment.getPoints())
         {
-            double x = utmPoint.x;
-            double y = utmPoint.y;
-            x = (x - m_minUtm.x) / (m_maxUtm.x - m_minUtm.x);
-            y = (y - m_minUtm.y) / (m_maxUtm.y - m_minUtm.y);
-
-            normalizedSegments.push_back(UtmPoint(x, y));
+            lons.push_back(point.getLongitude());
+            lats.push_back(point.getLatitude());
         }
-        m_normalizedUtmPoints.push_back(normalizedSegments);
+    }
+
+    std::vector<UtmPoint> projected(numPoints);
+    if (numPoints > 0)
+    {
+        GeoUtils::LonLat2UtmBatch(&lons[0], &lats[0], numPoints, &projected[0]);
+    }
+
+    utmPoints.reserve(utmPoints.size() + segments.size());
+    std::vector<UtmPoint>::const_iterator it = projected.begin();
+    BOOST_FOREACH(const GpsSegment& segment, segments)
+    {
+        const size_t numSegmentPoints = segment.getPoints().size();
+        utmPoints.push_back(UtmSegment(it, it + numSegmentPoints));
+        it += numSegmentPoints;
     }
 }
 
@@ -294,12 +594,10 @@ void GpsData::normalizeUtmPoints()
 //------------------------------------------------------------------------------
 void GpsData::setMinMaxRatioUTM()
 {
-    setMinMaxValuesUTM();
-
-    const double minLon = this->getMinUtmX();
-    const double maxLon = this->getMaxUtmX();
-    const double minLat = this->getMinUtmY();
-    const double maxLat = this->getMaxUtmY();
+    const double minLon = m_minUtmData.x;
+    const double maxLon = m_maxUtmData.x;
+    const double minLat = m_minUtmData.y;
+    const double maxLat = m_maxUtmData.y;
 
     // Calculate horizontal and vertical range.
     const double deltaLon = maxLon - minLon;
@@ -336,26 +634,206 @@ void GpsData::setMinMaxRatioUTM()
 
 //------------------------------------------------------------------------------
 
-void GpsData::setMinMaxValuesUTM()
+void GpsData::appendBounds(const size_t segmentStart)
+{
+    // Full chunks of a continued segment stay.
+    size_t numKeptChunks = 0;
+    if (segmentStart < m_segmentBounds.size())
+    {
+        const size_t numChunks =
+            m_chunkOffsets[segmentStart + 1] - m_chunkOffsets[segmentStart];
+        numKeptChunks = numChunks > 0 ? numChunks - 1 : 0;
+    }
+    m_segmentBounds.resize(segmentStart);
+    m_chunkOffsets.resize(segmentStart + 1);
+    m_chunkBounds.resize(m_chunkOffsets.back() + numKeptChunks);
+
+    for (size_t i = segmentStart; i < getNumSegments(); ++i)
+    {
+        UtmBounds segmentBounds;
+        size_t chunkBegin = m_segmentOffsets[i];
+        if (i == segmentStart)
+        {
+            for (size_t k = m_chunkOffsets[i]; k < m_chunkBounds.size(); ++k)
+            {
+                segmentBounds.add(m_chunkBounds[k]);
+            }
+            chunkBegin += numKeptChunks * BOUNDS_CHUNK_SIZE;
+        }
+        const size_t segmentEnd = m_segmentOffsets[i + 1];
+        for (; chunkBegin < segmentEnd; chunkBegin += BOUNDS_CHUNK_SIZE)
+        {
+            const size_t chunkEnd = MIN(chunkBegin + BOUNDS_CHUNK_SIZE,
+                                        segmentEnd);
+            UtmBounds chunkBounds;
+            for (size_t j = chunkBegin; j < chunkEnd; ++j)
+            {
+                chunkBounds.add(m_utmPoints[j]);
+            }
+            m_chunkBounds.push_back(chunkBounds);
+            segmentBounds.add(chunkBounds);
+        }
+        m_segmentBounds.push_back(segmentBounds);
+        m_chunkOffsets.push_back(m_chunkBounds.size());
+    }
+}
+
+//------------------------------------------------------------------------------
+
+/// Douglas-Peucker on the points given by indices, appends the kept indices.
+static void simplifyPolyline(const std::vector<UtmPoint>& points,
+                             const unsigned int* indices,
+                             const size_t numIndices,
+                             const double tolerance,
+                             std::vector<unsigned int>& simplified)
 {
-    ofxPoint<double> minXY = Utils::getPointDoubleMax();
-    ofxPoint<double> maxXY = Utils::getPointDoubleMin();
+    if (numIndices <= 2)
+    {
+        simplified.insert(simplified.end(), indices, indices + numIndices);
+        return;
+    }
 
-    BOOST_FOREACH(const UtmSegment& segments, m_utmPoints)
+    std::vector<bool> isKept(numIndices, false);
+    isKept[0] = true;
+    isKept[numIndices - 1] = true;
+
+    // No recursion, segments can have millions of points.
+    std::vector<std::pair<size_t, size_t> > ranges;
+    ranges.push_back(std::make_pair(0, numIndices - 1));
+    const double tolerance2 = tolerance * tolerance;
+    while (!ranges.empty())
     {
-        BOOST_FOREACH(const UtmPoint& utmPoint, segments)
+        const size_t first = ranges.back().first;
+        const size_t last = ranges.back().second;
+        ranges.pop_back();
+
+        const UtmPoint& a = points[indices[first]];
+        const UtmPoint& b = points[indices[last]];
+        const double dx = b.x - a.x;
+        const double dy = b.y - a.y;
+        const double length2 = dx * dx + dy * dy;
+
+        double maxDistance2 = 0.0;
+        size_t maxIndex = first;
+        for (size_t k = first + 1; k < last; ++k)
+        {
+            // Distance to the line segment, tracks often turn back.
+            const UtmPoint& p = points[indices[k]];
+            double t = length2 > 0.0
+                       ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / length2
+                       : 0.0;
+            t = MAX(0.0, MIN(1.0, t));
+            const double ex = p.x - (a.x + t * dx);
+            const double ey = p.y - (a.y + t * dy);
+            const double distance2 = ex * ex + ey * ey;
+            if (distance2 > maxDistance2)
+            {
+                maxDistance2 = distance2;
+                maxIndex = k;
+            }
+        }
+
+        if (maxDistance2 > tolerance2)
         {
-            const double x = utmPoint.x;
-            const double y = utmPoint.y;
-            minXY.x = MIN(x, minXY.x);
-            maxXY.x = MAX(x, maxXY.x);
-            minXY.y = MIN(y, minXY.y);
-            maxXY.y = MAX(y, maxXY.y);
+            isKept[maxIndex] = true;
+            ranges.push_back(std::make_pair(first, maxIndex));
+            ranges.push_back(std::make_pair(maxIndex, last));
         }
     }
 
-    m_minUtm = minXY;
-    m_maxUtm = maxXY;
+    for (size_t k = 0; k < numIndices; ++k)
+    {
+        if (isKept[k])
+        {
+            simplified.push_back(indices[k]);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void GpsData::calculateLod(const UtmDataVector& utmSegments, LodLevels& lod)
+{
+    lod.indices.assign(NUM_LOD_LEVELS, std::vector<unsigned int>());
+    lod.offsets.assign(NUM_LOD_LEVELS, std::vector<size_t>(1, 0));
+
+    std::vector<unsigned int> input;
+    std::vector<unsigned int> simplified;
+    size_t pointOffset = 0;
+    BOOST_FOREACH(const UtmSegment& utmSegment, utmSegments)
+    {
+        input.clear();
+        for (size_t j = 0; j < utmSegment.size(); ++j)
+        {
+            input.push_back(static_cast<unsigned int>(j));
+        }
+        for (size_t level = 1; level < NUM_LOD_LEVELS; ++level)
+        {
+            simplified.clear();
+            simplifyPolyline(utmSegment, input.empty() ? 0 : &input[0],
+                             input.size(), getLodStepTolerance(level),
+                             simplified);
+            BOOST_FOREACH(const unsigned int index, simplified)
+            {
+                lod.indices[level].push_back(
+                    static_cast<unsigned int>(pointOffset + index));
+            }
+            lod.offsets[level].push_back(lod.indices[level].size());
+            input.swap(simplified);
+        }
+        pointOffset += utmSegment.size();
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void GpsData::appendLod(const LodLevels& lod,
+                        const size_t pointStart,
+                        const bool isContinued)
+{
+    for (size_t level = 1; level < NUM_LOD_LEVELS; ++level)
+    {
+        std::vector<unsigned int>& indices = m_lodIndices[level];
+        std::vector<size_t>& offsets = m_lodOffsets[level];
+        const std::vector<size_t>& lodOffsets = lod.offsets[level];
+
+        const size_t indexStart = indices.size();
+        BOOST_FOREACH(const unsigned int index, lod.indices[level])
+        {
+            indices.push_back(static_cast<unsigned int>(pointStart + index));
+        }
+        // The levels of a continued segment are the ones of its parts, the
+        // end points of all parts are kept.
+        for (size_t i = 1; i < lodOffsets.size(); ++i)
+        {
+            if (i == 1 && isContinued)
+            {
+                offsets.back() = indexStart + lodOffsets[i];
+            }
+            else
+            {
+                offsets.push_back(indexStart + lodOffsets[i]);
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void GpsData::setMinMaxValuesUTM(const size_t pointStart)
+{
+    ofxPoint<double>& minXY = m_minUtmData;
+    ofxPoint<double>& maxXY = m_maxUtmData;
+
+    for (size_t i = pointStart; i < m_utmPoints.size(); ++i)
+    {
+        const double x = m_utmPoints[i].x;
+        const double y = m_utmPoints[i].y;
+        minXY.x = MIN(x, minXY.x);
+        maxXY.x = MAX(x, maxXY.x);
+        minXY.y = MIN(y, minXY.y);
+        maxXY.y = MAX(y, maxXY.y);
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -12,13 +12,29 @@
 
 
 /**
- * \brief Holds a vector with segments, user and min/max values for longitude/latitude.
+ * \brief Holds the segments of a user and min/max values for longitude/latitude.
  *
+ * Points are stored column-wise in contiguous arrays, segments are ranges
+ * given by offsets into them. Points reference their location by id.
  */
 class GpsData : public boost::enable_shared_from_this<GpsData>
 {
 
 public:
+
+    /**
+    * \brief Simplification levels of some segments, calculated apart from
+    * a GpsData, e.g. on a loader thread.
+    *
+    * Per level point indices, relative to the first point of the segments,
+    * and offsets per segment into them.
+    */
+    struct LodLevels
+    {
+        std::vector<std::vector<unsigned int> > indices;
+        std::vector<std::vector<size_t> > offsets;
+    };
+
     GpsData(const AppSettings& settings);
 	~GpsData();
 
@@ -27,13 +43,34 @@ public:
     void setGpsData(const GpsSegmentVector& segments,
                     const ofxPoint<double>& minLonLat,
                     const ofxPoint<double>& maxLonLat,
-					const std::string& user);
+					const std::string& user,
+                    const LocationMapPtr& locations);
+
+    /**
+    * \brief Append already projected segments, e.g. while streaming.
+    *
+    * A first segment with the number of the last segment continues it,
+    * long segments are streamed in parts.
+    * \param segments segments to append.
+    * \param utmSegments projected points of segments.
+    * \param lod simplification levels of utmSegments.
+    * \param minLonLat min longitude/latitude of the appended segments.
+    * \param maxLonLat max longitude/latitude of the appended segments.
+    * \param user name of user.
+    * \param locations names for the location ids of the points.
+    */
+    void addGpsData(const GpsSegmentVector& segments,
+                    const UtmDataVector& utmSegments,
+                    const LodLevels& lod,
+                    const ofxPoint<double>& minLonLat,
+                    const ofxPoint<double>& maxLonLat,
+                    const std::string& user,
+                    const LocationMapPtr& locations);
 
     void clear();
 
     //--------------------------------------------------------------------------
 
-    const GpsSegmentVector& getSegments() const { return m_segments; }
     double getMinLon() const { return m_minLonLat.x; }
     double getMaxLon() const { return m_maxLonLat.x; }
     double getMinLat() const { return m_minLonLat.y; }
@@ -43,9 +80,21 @@ public:
     double getMinUtmY() const { return m_minUtm.y; }
     double getMaxUtmY() const { return m_maxUtm.y; }
 
+    size_t getNumSegments() const { return m_segmentNums.size(); }
+    size_t getNumPoints(size_t segmentIndex) const;
+    /**
+    * \brief Get the index of the first point of a segment in all points.
+    */
+    size_t getSegmentOffset(size_t segmentIndex) const;
+    int getSegmentNum(size_t segmentIndex) const;
+
     double getLongitude(size_t segmentIndex, size_t pointIndex) const;
     double getLatitude(size_t segmentIndex, size_t pointIndex) const;
     double getElevation(size_t segmentIndex, size_t pointIndex) const;
+    double getSpeed(size_t segmentIndex, size_t pointIndex) const;
+    tEpoch getTime(size_t segmentIndex, size_t pointIndex) const;
+    const std::string getTimestamp(size_t segmentIndex, size_t pointIndex) const;
+    int getGpsPointId(size_t segmentIndex, size_t pointIndex) const;
     double getUtmX(size_t segmentIndex, size_t pointIndex) const;
     double getUtmY(size_t segmentIndex, size_t pointIndex) const;
     UtmPoint getUtm(size_t segmentIndex, size_t pointIndex) const;
@@ -56,65 +105,182 @@ public:
 
     const std::string getGpsLocation(size_t segmentIndex, size_t pointIndex) const;
 
-    int getTotalGpsPoints() const;
+    int getTotalGpsPoints() const { return static_cast<int>(m_ids.size()); }
+
+    /**
+    * \brief Find segment and point of a point by its index in all points.
+    *
+    * Binary search over the segment offsets, O(log segments).
+    * \param index index of the point in all points.
+    * \param segmentIndex segment of the point.
+    * \param pointIndex index of the point in the segment.
+    * \return false if index is out of range.
+    */
+    bool getSegmentAndPoint(size_t index,
+                            size_t& segmentIndex,
+                            size_t& pointIndex) const;
 
     static GpsPoint getGpsPoint(const ofxPoint<double>& utmP);
 
-    const UtmDataVector& getUTMPoints() const { return m_utmPoints; }
-    const UtmDataVector& getNormalizedUTMPoints() const
-    { return m_normalizedUtmPoints; }
+    /**
+    * \brief Get projected points of a segment.
+    */
+    UtmSegmentView getUtmSegment(size_t segmentIndex) const;
+    /**
+    * \brief Get speed values of a segment.
+    */
+    ArrayView<double> getSpeedSegment(size_t segmentIndex) const;
+    /**
+    * \brief Get projected points of all segments.
+    */
+    UtmSegmentView getUtmPoints() const;
+    /**
+    * \brief Get speed values of all segments.
+    */
+    ArrayView<double> getSpeeds() const;
+    /**
+    * \brief Get the bounds of all points of a segment.
+    */
+    const UtmBounds& getSegmentBounds(size_t segmentIndex) const;
+    /**
+    * \brief Get the bounds of the chunks of a segment.
+    *
+    * Chunk k holds the points from k * BOUNDS_CHUNK_SIZE of the segment.
+    */
+    ArrayView<UtmBounds> getChunkBounds(size_t segmentIndex) const;
+    /**
+    * \brief Get the points kept in a simplification level.
+    *
+    * Levels 1 to NUM_LOD_LEVELS - 1 hold indices into all points,
+    * within getLodTolerance(level) of all points. Level 0 are all points.
+    */
+    ArrayView<unsigned int> getLodIndices(size_t level) const;
+    /**
+    * \brief Get the index of the first point of a segment in getLodIndices().
+    */
+    size_t getLodSegmentOffset(size_t level, size_t segmentIndex) const;
+    /**
+    * \brief Max distance in UTM units of the points of all segments to
+    * their simplified lines at a level.
+    *
+    * Includes the errors of all levels below, a level is simplified from
+    * the one below it.
+    */
+    static double getLodTolerance(size_t level);
+    /**
+    * \brief Get times of all points in load order.
+    */
+    ArrayView<tEpoch> getTimes() const;
+    /**
+    * \brief Get ids of all points in load order.
+    */
+    ArrayView<int> getGpsPointIds() const;
 
 	const std::string& getUser() const { return m_user; }
-    const GpsDataIndexVector& getIndices() const { return m_indices; }
-
-    //--------------------------------------------------------------------------
 
-    void calculateUtmPointsWithIndex();
+    /// Number of points with one bounding box in long segments.
+    static const size_t BOUNDS_CHUNK_SIZE = 256;
+    /// Number of simplification levels including the full data.
+    static const size_t NUM_LOD_LEVELS = 10;
 
     //--------------------------------------------------------------------------
 
-private:
+    static void calculateUtmPoints(const GpsSegmentVector& segments,
+                                   UtmDataVector& utmPoints);
 
-    typedef boost::function<double(const GpsPoint&)> tFnGetGpsData;
-    double getData(size_t segmentIndex, size_t pointIndex,
-                   const tFnGetGpsData& fnGetGpsData) const;
+    /**
+    * \brief Simplify projected segments for all levels.
+    *
+    * Douglas-Peucker, each level starts from the points of the one below.
+    * The tolerance of each step is four times the one of the step before.
+    */
+    static void calculateLod(const UtmDataVector& utmSegments,
+                             LodLevels& lod);
 
-    tFnGetGpsData fnGetLongitude;
-    tFnGetGpsData fnGetLatitude;
-    tFnGetGpsData fnGetElevation;
+    //--------------------------------------------------------------------------
 
-    typedef boost::function<double(const UtmPoint&)> tFnGetUtmData;
-    double getUtmData(size_t segmentIndex, size_t pointIndex,
-                      const UtmDataVector& utmVec,
-                      const tFnGetUtmData& fnGetUtmData) const;
+private:
 
-    tFnGetUtmData fnGetUtmX;
-    tFnGetUtmData fnGetUtmY;
+    friend class GpsDataCache;
 
-    //--------------------------------------------------------------------------
+    /**
+    * \brief Index into the point columns.
+    * \return false if the point does not exist.
+    */
+    bool getPointIndex(size_t segmentIndex, size_t pointIndex,
+                       size_t& index) const;
 
-    void normalizeUtmPoints();
+    /**
+    * \brief Append points and segments to the columns.
+    * \param isContinued the first segment continues the last one.
+    */
+    void appendSegments(const GpsSegmentVector& segments,
+                        const UtmDataVector& utmSegments,
+                        bool isContinued = false);
 
     //--------------------------------------------------------------------------
 
     void setMinMaxRatioUTM();
-	void setMinMaxValuesUTM();
+    /**
+    * \brief Extend the min/max UTM values by the points from pointStart on.
+    */
+	void setMinMaxValuesUTM(size_t pointStart);
+    /**
+    * \brief Calculate segment and chunk bounds from segmentStart on.
+    *
+    * If segmentStart already has bounds, it was continued. Its full chunks
+    * are kept and only its last chunk is calculated again.
+    */
+    void appendBounds(size_t segmentStart);
+    /**
+    * \brief Append simplification levels of appended segments.
+    * \param lod levels from calculateLod().
+    * \param pointStart index of the first point of the segments.
+    * \param isContinued the first segment continues the last one.
+    */
+    void appendLod(const LodLevels& lod, size_t pointStart, bool isContinued);
 
     //--------------------------------------------------------------------------
 
     int m_gpsDataId;
-    GpsSegmentVector m_segments;
 	std::string m_user;
 
     ofxPoint<double> m_minLonLat;
     ofxPoint<double> m_maxLonLat;
     ofxPoint<double> m_minUtm;
     ofxPoint<double> m_maxUtm;
-
-    UtmDataVector m_utmPoints;
-    UtmDataVector m_normalizedUtmPoints;
-
-    GpsDataIndexVector m_indices;
+    ofxPoint<double> m_minUtmData;
+    ofxPoint<double> m_maxUtmData;
+
+    // Point columns, one entry per point of all segments.
+    std::vector<double> m_latitudes;
+    std::vector<double> m_longitudes;
+    std::vector<double> m_elevations;
+    std::vector<double> m_speeds;
+    std::vector<tEpoch> m_times;
+    std::vector<int> m_ids;
+    std::vector<int> m_locationIds;
+    std::vector<UtmPoint> m_utmPoints;
+
+    // Segment columns, offsets has one more entry for the end of the last
+    // segment. The offsets map point indices to segments by binary search,
+    // see getSegmentAndPoint().
+    std::vector<size_t> m_segmentOffsets;
+    std::vector<int> m_segmentNums;
+    UtmBoundsVector m_segmentBounds;
+
+    // Chunk bounds of all segments, chunkOffsets has one more entry like
+    // segmentOffsets.
+    UtmBoundsVector m_chunkBounds;
+    std::vector<size_t> m_chunkOffsets;
+
+    // Per level point indices and segment offsets into them, level 0 is
+    // empty.
+    std::vector<std::vector<unsigned int> > m_lodIndices;
+    std::vector<std::vector<size_t> > m_lodOffsets;
+
+    // Shared by all GpsData read with the same database connection.
+    LocationMapPtr m_locations;
 };
 
 #endif // _GPSDATA_H_
@@ -0,0 +1,427 @@
+/*=======================================================
+ Copyright (c) avp::ptr, 2010
+=======================================================*/
+
+#include "GpsDataCache.h"
+#include "GpsData.h"
+
+#include <cstring>
+#include <fstream>
+
+#include "Poco/Exception.h"
+#include "Poco/File.h"
+#include "Poco/SharedMemory.h"
+#include "Poco/Types.h"
+
+//------------------------------------------------------------------------------
+// File layout
+//
+// CacheHeader, key, user, segment offsets, segment numbers, then one array
+// per point column (latitude, longitude, elevation, speed, UTM x/y pairs,
+// time, id, location id), per simplification level its segment offsets and
+// point indices, the location dictionary ids and the location strings. Every
+// part starts 8 byte aligned, location strings are 0-terminated.
+//------------------------------------------------------------------------------
+
+static const char CACHE_MAGIC[4] = { 'D', 'L', 'G', 'C' };
+
+/// Has to be increased whenever the layout or the loaded data changes.
+static const Poco::UInt32 CACHE_VERSION = 4;
+
+static const char* CACHE_DIR = "cache/";
+
+struct CacheHeader
+{
+    char magic[4];
+    Poco::UInt32 version;
+    Poco::UInt64 fileSize;
+    Poco::UInt32 keySize;
+    Poco::UInt32 userSize;
+    Poco::UInt32 numSegments;
+    Poco::UInt32 numPoints;
+    Poco::UInt32 numLocations;
+    Poco::UInt32 locationsSize;
+    Poco::UInt32 numLodIndices[GpsData::NUM_LOD_LEVELS];
+    double minLon;
+    double minLat;
+    double maxLon;
+    double maxLat;
+};
+
+//------------------------------------------------------------------------------
+
+static Poco::UInt64 align8(const Poco::UInt64 size)
+{
+    return (size + 7) & ~static_cast<Poco::UInt64>(7);
+}
+
+//------------------------------------------------------------------------------
+
+/// 64 bit FNV-1a hash.
+static Poco::UInt64 hashString(const std::string& str)
+{
+    Poco::UInt64 hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < str.size(); ++i)
+    {
+        hash ^= static_cast<unsigned char>(str[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+//------------------------------------------------------------------------------
+
+static Poco::UInt64 getFileSize(const CacheHeader& header)
+{
+    const Poco::UInt64 numSegments = header.numSegments;
+    const Poco::UInt64 numPoints = header.numPoints;
+
+    Poco::UInt64 size = align8(sizeof(CacheHeader));
+    size += align8(header.keySize);
+    size += align8(header.userSize);
+    size += align8((numSegments + 1) * sizeof(Poco::UInt64));
+    size += align8(numSegments * sizeof(Poco::Int32));
+    size += 6 * numPoints * sizeof(double);
+    size += numPoints * sizeof(Poco::Int64);
+    size += 2 * align8(numPoints * sizeof(Poco::Int32));
+    for (size_t level = 1; level < GpsData::NUM_LOD_LEVELS; ++level)
+    {
+        size += align8((numSegments + 1) * sizeof(Poco::UInt64));
+        size += align8(header.numLodIndices[level] * sizeof(Poco::UInt32));
+    }
+    size += align8(header.numLocations * sizeof(Poco::Int32));
+    size += header.locationsSize;
+    return size;
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+static const T* readSection(const char*& pos, const Poco::UInt64 count)
+{
+    const T* section = reinterpret_cast<const T*>(pos);
+    pos += align8(count * sizeof(T));
+    return section;
+}
+
+//------------------------------------------------------------------------------
+
+static void writePadded(std::ofstream& file, const char* data, const size_t size)
+{
+    static const char padding[8] = { 0 };
+    if (size > 0)
+    {
+        file.write(data, size);
+    }
+    file.write(padding, align8(size) - size);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename T>
+static void writeSection(std::ofstream& file, const std::vector<T>& values)
+{
+    writePadded(file,
+                values.empty() ? 0 : reinterpret_cast<const char*>(&values[0]),
+                values.size() * sizeof(T));
+}
+
+//------------------------------------------------------------------------------
+
+std::string GpsDataCache::makeKey(const AppSettings& settings,
+                                  const std::string& query)
+{
+    const std::string& dbPath = settings.getDatabasePath();
+    long long dbModified = 0;
+    try
+    {
+        dbModified = Poco::File(dbPath).getLastModified().epochTime();
+    }
+    catch (const Poco::Exception&) {}
+
+    std::stringstream key;
+    key << "version: " << CACHE_VERSION << "\n";
+    key << "database: " << dbPath << "\n";
+    key << "modified: " << dbModified << "\n";
+    key << "speed: " << settings.useSpeed() << "\n";
+    key << "query: " << query;
+    return key.str();
+}
+
+//------------------------------------------------------------------------------
+
+bool GpsDataCache::load(const std::string& key, GpsData& gpsData)
+{
+    const std::string path = getFilePath(key);
+    try
+    {
+        const Poco::File file(path);
+        if (!file.exists())
+        {
+            return false;
+        }
+
+        const Poco::SharedMemory mapped(file, Poco::SharedMemory::AM_READ);
+        const char* data = mapped.begin();
+        const Poco::UInt64 size = mapped.end() - mapped.begin();
+
+        // Validate before anything is read behind the header.
+        if (size < sizeof(CacheHeader))
+        {
+            ofLogWarning(Logger::GPS_DATA_CACHE) << "Invalid cache file: " << path;
+            return false;
+        }
+        const CacheHeader& header = *reinterpret_cast<const CacheHeader*>(data);
+        if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+            header.version != CACHE_VERSION ||
+            header.fileSize != size ||
+            getFileSize(header) != size ||
+            (header.locationsSize > 0 && data[size - 1] != '\0'))
+        {
+            ofLogWarning(Logger::GPS_DATA_CACHE) << "Invalid cache file: " << path;
+            return false;
+        }
+
+        const Poco::UInt32 numSegments = header.numSegments;
+        const Poco::UInt32 numPoints = header.numPoints;
+
+        const char* pos = data + align8(sizeof(CacheHeader));
+        const char* keyData = readSection<char>(pos, header.keySize);
+        if (std::string(keyData, header.keySize) != key)
+        {
+            // Hash collision or outdated key.
+            return false;
+        }
+        const char* userData = readSection<char>(pos, header.userSize);
+        const Poco::UInt64* offsets =
+            readSection<Poco::UInt64>(pos, numSegments + 1);
+        const Poco::Int32* segmentNums =
+            readSection<Poco::Int32>(pos, numSegments);
+        const double* latitudes = readSection<double>(pos, numPoints);
+        const double* longitudes = readSection<double>(pos, numPoints);
+        const double* elevations = readSection<double>(pos, numPoints);
+        const double* speeds = readSection<double>(pos, numPoints);
+        const double* utmXY = readSection<double>(pos, 2 * numPoints);
+        const Poco::Int64* times = readSection<Poco::Int64>(pos, numPoints);
+        const Poco::Int32* ids = readSection<Poco::Int32>(pos, numPoints);
+        const Poco::Int32* locationIds =
+            readSection<Poco::Int32>(pos, numPoints);
+        const Poco::UInt64* lodOffsets[GpsData::NUM_LOD_LEVELS] = { 0 };
+        const Poco::UInt32* lodIndices[GpsData::NUM_LOD_LEVELS] = { 0 };
+        for (size_t level = 1; level < GpsData::NUM_LOD_LEVELS; ++level)
+        {
+            lodOffsets[level] = readSection<Poco::UInt64>(pos, numSegments + 1);
+            lodIndices[level] =
+                readSection<Poco::UInt32>(pos, header.numLodIndices[level]);
+        }
+        const Poco::Int32* locationKeys =
+            readSection<Poco::Int32>(pos, header.numLocations);
+        const char* locations = pos;
+
+        bool isValid = offsets[0] == 0 && offsets[numSegments] == numPoints;
+        for (Poco::UInt32 i = 0; i < numSegments && isValid; ++i)
+        {
+            isValid = offsets[i] <= offsets[i + 1];
+        }
+        for (size_t level = 1; level < GpsData::NUM_LOD_LEVELS && isValid; ++level)
+        {
+            const Poco::UInt32 numIndices = header.numLodIndices[level];
+            isValid = lodOffsets[level][0] == 0 &&
+                      lodOffsets[level][numSegments] == numIndices;
+            for (Poco::UInt32 i = 0; i < numSegments && isValid; ++i)
+            {
+                isValid = lodOffsets[level][i] <= lodOffsets[level][i + 1];
+            }
+            for (Poco::UInt32 i = 0; i < numIndices && isValid; ++i)
+            {
+                isValid = lodIndices[level][i] < numPoints;
+            }
+        }
+
+        boost::shared_ptr<LocationMap> locationMap(new LocationMap());
+        Poco::UInt32 numLocations = 0;
+        for (const char* location = locations;
+             location < locations + header.locationsSize && isValid;
+             location += std::strlen(location) + 1)
+        {
+            isValid = numLocations < header.numLocations;
+            if (isValid)
+            {
+                (*locationMap)[locationKeys[numLocations++]] = location;
+            }
+        }
+        isValid = isValid && numLocations == header.numLocations;
+
+        if (!isValid)
+        {
+            ofLogWarning(Logger::GPS_DATA_CACHE) << "Invalid cache file: " << path;
+            return false;
+        }
+
+        gpsData.clear();
+        ++gpsData.m_gpsDataId;
+        gpsData.m_user.assign(userData, header.userSize);
+        gpsData.m_minLonLat = ofxPoint<double>(header.minLon, header.minLat);
+        gpsData.m_maxLonLat = ofxPoint<double>(header.maxLon, header.maxLat);
+
+        gpsData.m_segmentOffsets.assign(offsets, offsets + numSegments + 1);
+        gpsData.m_segmentNums.assign(segmentNums, segmentNums + numSegments);
+        gpsData.m_latitudes.assign(latitudes, latitudes + numPoints);
+        gpsData.m_longitudes.assign(longitudes, longitudes + numPoints);
+        gpsData.m_elevations.assign(elevations, elevations + numPoints);
+        gpsData.m_speeds.assign(speeds, speeds + numPoints);
+        gpsData.m_times.assign(times, times + numPoints);
+        gpsData.m_ids.assign(ids, ids + numPoints);
+        gpsData.m_locationIds.assign(locationIds, locationIds + numPoints);
+        gpsData.m_utmPoints.reserve(numPoints);
+        for (Poco::UInt32 i = 0; i < numPoints; ++i)
+        {
+            gpsData.m_utmPoints.push_back(UtmPoint(utmXY[2 * i],
+                                                   utmXY[2 * i + 1]));
+        }
+        gpsData.m_locations = locationMap;
+        // Simplification is stored, a warm load does not run it again.
+        for (size_t level = 1; level < GpsData::NUM_LOD_LEVELS; ++level)
+        {
+            gpsData.m_lodOffsets[level].assign(
+                lodOffsets[level], lodOffsets[level] + numSegments + 1);
+            gpsData.m_lodIndices[level].assign(
+                lodIndices[level],
+                lodIndices[level] + header.numLodIndices[level]);
+        }
+
+        gpsData.setMinMaxValuesUTM(0);
+        gpsData.setMinMaxRatioUTM();
+        gpsData.appendBounds(0);
+
+        ofLogVerbose(Logger::GPS_DATA_CACHE) << "Loaded " << path;
+        return true;
+    }
+    catch (const Poco::Exception& e)
+    {
+        ofLogWarning(Logger::GPS_DATA_CACHE) << "Could not read cache file "
+                                             << path << ": " << e.displayText();
+        return false;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+bool GpsDataCache::save(const std::string& key, const GpsData& gpsData)
+{
+    const size_t numPoints = gpsData.m_ids.size();
+
+    const std::vector<Poco::UInt64> offsets(gpsData.m_segmentOffsets.begin(),
+                                            gpsData.m_segmentOffsets.end());
+    std::vector<double> utmXY;
+    utmXY.reserve(2 * numPoints);
+    BOOST_FOREACH(const UtmPoint& utmPoint, gpsData.m_utmPoints)
+    {
+        utmXY.push_back(utmPoint.x);
+        utmXY.push_back(utmPoint.y);
+    }
+    const std::vector<Poco::Int64> times(gpsData.m_times.begin(),
+                                         gpsData.m_times.end());
+    std::vector<Poco::Int32> locationKeys;
+    std::string locations;
+    if (gpsData.m_locations)
+    {
+        BOOST_FOREACH(const LocationMap::value_type& location, *gpsData.m_locations)
+        {
+            locationKeys.push_back(location.first);
+            locations.append(location.second.c_str(), location.second.size() + 1);
+        }
+    }
+
+    const std::string& user = gpsData.getUser();
+
+    CacheHeader header;
+    std::memset(&header, 0, sizeof(CacheHeader));
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.keySize = static_cast<Poco::UInt32>(key.size());
+    header.userSize = static_cast<Poco::UInt32>(user.size());
+    header.numSegments = static_cast<Poco::UInt32>(gpsData.getNumSegments());
+    header.numPoints = static_cast<Poco::UInt32>(numPoints);
+    header.numLocations = static_cast<Poco::UInt32>(locationKeys.size());
+    header.locationsSize = static_cast<Poco::UInt32>(locations.size());
+    std::vector<std::vector<Poco::UInt64> > lodOffsets(GpsData::NUM_LOD_LEVELS);
+    for (size_t level = 1; level < GpsData::NUM_LOD_LEVELS; ++level)
+    {
+        lodOffsets[level].assign(gpsData.m_lodOffsets[level].begin(),
+                                 gpsData.m_lodOffsets[level].end());
+        header.numLodIndices[level] =
+            static_cast<Poco::UInt32>(gpsData.m_lodIndices[level].size());
+    }
+    header.minLon = gpsData.getMinLon();
+    header.minLat = gpsData.getMinLat();
+    header.maxLon = gpsData.getMaxLon();
+    header.maxLat = gpsData.getMaxLat();
+    header.fileSize = getFileSize(header);
+
+    const std::string path = getFilePath(key);
+    const std::string tmpPath = path + ".tmp";
+    try
+    {
+        Poco::File(ofToDataPath(CACHE_DIR)).createDirectories();
+
+        {
+            std::ofstream file(tmpPath.c_str(),
+                               std::ios::out | std::ios::binary | std::ios::trunc);
+            writePadded(file, reinterpret_cast<const char*>(&header),
+                        sizeof(CacheHeader));
+            writePadded(file, key.data(), key.size());
+            writePadded(file, user.data(), user.size());
+            writeSection(file, offsets);
+            writeSection(file, gpsData.m_segmentNums);
+            writeSection(file, gpsData.m_latitudes);
+            writeSection(file, gpsData.m_longitudes);
+            writeSection(file, gpsData.m_elevations);
+            writeSection(file, gpsData.m_speeds);
+            writeSection(file, utmXY);
+            writeSection(file, times);
+            writeSection(file, gpsData.m_ids);
+            writeSection(file, gpsData.m_locationIds);
+            for (size_t level = 1; level < GpsData::NUM_LOD_LEVELS; ++level)
+            {
+                writeSection(file, lodOffsets[level]);
+                writeSection(file, gpsData.m_lodIndices[level]);
+            }
+            writeSection(file, locationKeys);
+            file.write(locations.data(), locations.size());
+            if (!file)
+            {
+                ofLogWarning(Logger::GPS_DATA_CACHE) << "Could not write cache file: "
+                                                     << tmpPath;
+                file.close();
+                Poco::File(tmpPath).remove();
+                return false;
+            }
+        }
+
+        // A complete file replaces the old one, readers never see a
+        // partially written cache.
+        Poco::File(tmpPath).renameTo(path);
+    }
+    catch (const Poco::Exception& e)
+    {
+        ofLogWarning(Logger::GPS_DATA_CACHE) << "Could not write cache file "
+                                             << path << ": " << e.displayText();
+        return false;
+    }
+
+    ofLogVerbose(Logger::GPS_DATA_CACHE) << "Saved " << path;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+std::string GpsDataCache::getFilePath(const std::string& key)
+{
+    char name[40];
+    sprintf(name, "gpsdata_%016llx.bin",
+            static_cast<unsigned long long>(hashString(key)));
+    return ofToDataPath(std::string(CACHE_DIR) + name);
+}
+
+//------------------------------------------------------------------------------
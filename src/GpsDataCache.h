@@ -0,0 +1,56 @@
+/*=======================================================
+ Copyright (c) avp::ptr, 2010
+=======================================================*/
+
+#ifndef _GPSDATACACHE_H_
+#define _GPSDATACACHE_H_
+
+#include "DrawingLifeIncludes.h"
+
+/**
+ * \brief On-disk cache for loaded and projected GpsData.
+ *
+ * One file per query holds segments, points, projected UTM points and the
+ * location dictionary. The file is memory mapped on load, so neither the
+ * database nor proj is needed on a warm start.
+ */
+class GpsDataCache
+{
+public:
+
+    /**
+    * \brief Build the key for a query.
+    *
+    * Contains the query, the database path and modification time and the
+    * settings that change the loaded data.
+    * \param settings application settings.
+    * \param query description of the query, e.g. the sql statement.
+    * \return key string.
+    */
+    static std::string makeKey(const AppSettings& settings,
+                               const std::string& query);
+
+    /**
+    * \brief Load cached GpsData.
+    * \param key cache key from makeKey().
+    * \param gpsData GpsData to fill.
+    * \return true if a valid cache file was found.
+    */
+    static bool load(const std::string& key, GpsData& gpsData);
+
+    /**
+    * \brief Write GpsData to the cache.
+    * \param key cache key from makeKey().
+    * \param gpsData GpsData to write.
+    * \return true on success.
+    */
+    static bool save(const std::string& key, const GpsData& gpsData);
+
+private:
+
+    static std::string getFilePath(const std::string& key);
+
+    GpsDataCache();
+};
+
+#endif // _GPSDATACACHE_H_
@@ -0,0 +1,304 @@
+/*=======================================================
+ Copyright (c) avp::ptr, 2010
+=======================================================*/
+
+#include "GpsDataStreamLoader.h"
+#include "DrawingLifeApp.h"
+#include "DBReader.h"
+#include "GpsDataCache.h"
+#include "GeoUtils.h"
+
+//------------------------------------------------------------------------------
+
+/// Number of points read before a chunk is handed over.
+static const size_t CHUNK_SIZE = 5000;
+
+//------------------------------------------------------------------------------
+
+class GpsDataStreamLoader::PersonWorker : public Poco::Runnable
+{
+public:
+
+    PersonWorker(GpsDataStreamLoader& loader,
+                 DBReader& dbReader,
+                 const DataLoader::tFuncLoadGpsData& getGpsDataFunc,
+                 size_t personIndex)
+        : m_loader(loader), m_dbReader(dbReader),
+          m_getGpsDataFunc(getGpsDataFunc), m_personIndex(personIndex) {}
+
+    void run()
+    {
+        m_dbReader.setSegmentSink(
+            boost::bind(&GpsDataStreamLoader::addChunk, &m_loader,
+                        m_personIndex, m_dbReader.getLocations(), _1, _2),
+            CHUNK_SIZE);
+
+        // Stays empty, the data goes to the sink.
+        GpsData gpsData(m_loader.m_settings);
+        const bool loadOk = m_getGpsDataFunc(&m_dbReader, gpsData);
+
+        m_dbReader.closeDbConnection();
+        m_loader.setFinished(m_personIndex, loadOk);
+    }
+
+private:
+
+    GpsDataStreamLoader& m_loader;
+    DBReader& m_dbReader;
+    DataLoader::tFuncLoadGpsData m_getGpsDataFunc;
+    size_t m_personIndex;
+};
+
+//------------------------------------------------------------------------------
+
+GpsDataStreamLoader::GpsDataStreamLoader(const AppSettings& settings)
+:
+m_settings(settings),
+m_cancel(false),
+m_isLoading(false)
+{
+}
+
+//------------------------------------------------------------------------------
+
+GpsDataStreamLoader::~GpsDataStreamLoader()
+{
+    stop();
+}
+
+//------------------------------------------------------------------------------
+
+bool GpsDataStreamLoader::start(
+    const std::vector<DataLoader::tFuncLoadGpsData>& funcVec,
+    const StringVec& cacheKeys)
+{
+    stop();
+
+    const size_t numPersons = funcVec.size();
+
+    m_cancel = false;
+    m_pending.assign(numPersons, ChunkVector());
+    m_numRows.assign(numPersons, 0);
+    m_finished.assign(numPersons, 0);
+    m_loadOk.assign(numPersons, 0);
+    m_cacheKeys = cacheKeys;
+
+    // Projection has to be set up before it is used by the workers.
+    GeoUtils::init();
+
+    m_threadPool.reset(new Poco::ThreadPool(1, std::max<int>(1, numPersons)));
+
+    // Connections are opened here, so that spatialite initialization is not
+    // done concurrently.
+    size_t numQueries = 0;
+    for (size_t i = 0; i < numPersons; ++i)
+    {
+        if (funcVec[i].empty())
+        {
+            m_finished[i] = 1;
+            continue;
+        }
+        ++numQueries;
+
+        DBReader* dbReader = new DBReader(m_settings.getDatabasePath(),
+                                          m_settings.useSpeed());
+        m_dbReaders.push_back(dbReader);
+        if (!dbReader->setupDbConnection())
+        {
+            m_finished[i] = 1;
+            continue;
+        }
+
+        m_workers.push_back(new PersonWorker(*this, *dbReader, funcVec[i], i));
+        m_threadPool->start(m_workers.back());
+    }
+
+    if (numQueries > 0 && m_workers.empty())
+    {
+        ofLogError(Logger::DATA_LOADER) << "No database connection for loading!";
+        stop();
+        return false;
+    }
+
+    m_isLoading = true;
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+void GpsDataStreamLoader::stop()
+{
+    {
+        Poco::FastMutex::ScopedLock lock(m_mutex);
+        m_cancel = true;
+    }
+
+    if (m_threadPool)
+    {
+        m_threadPool->joinAll();
+        m_threadPool.reset();
+    }
+    m_workers.clear();
+    m_dbReaders.clear();
+
+    m_isLoading = false;
+}
+
+//------------------------------------------------------------------------------
+
+bool GpsDataStreamLoader::update(DrawingLifeApp& app)
+{
+    if (!m_isLoading)
+    {
+        return false;
+    }
+
+    std::vector<ChunkVector> chunks(m_pending.size());
+    std::vector<int> finished;
+    std::vector<int> loadOk;
+    {
+        Poco::FastMutex::ScopedLock lock(m_mutex);
+        for (size_t i = 0; i < m_pending.size(); ++i)
+        {
+            chunks[i].swap(m_pending[i]);
+        }
+        finished = m_finished;
+        loadOk = m_loadOk;
+    }
+
+    GpsDataVector& gpsDatas = app.getGpsDataVector();
+    WalkVector& walks = app.getWalkVector();
+    MagicBoxVector& magicBoxes = app.getMagicBoxVector();
+
+    // In multi mode all walks share one box, it is centered once.
+    bool isBoxSetup = false;
+    BOOST_FOREACH(const GpsDataPtr& gpsData, gpsDatas)
+    {
+        isBoxSetup = isBoxSetup ||
+                (m_settings.isMultiMode() && gpsData->getNumSegments() > 0);
+    }
+
+    bool dataAdded = false;
+    for (size_t i = 0; i < chunks.size() && i < gpsDatas.size(); ++i)
+    {
+        GpsData& gpsData = *gpsDatas[i];
+        BOOST_FOREACH(const Chunk& chunk, chunks[i])
+        {
+            const bool isFirstChunk = gpsData.getNumSegments() == 0;
+
+            gpsData.addGpsData(chunk.segments, chunk.utmSegments, chunk.lod,
+                               chunk.minLonLat, chunk.maxLonLat, chunk.user,
+                               chunk.locations);
+            dataAdded = true;
+
+            // Walks were set up without data, center the box on the first
+            // point now.
+            if (isFirstChunk && !isBoxSetup && !m_settings.isBoundingBoxFixed())
+            {
+                const MagicBoxPtr& box =
+                    m_settings.isMultiMode() ? magicBoxes[0] : magicBoxes[i];
+                walks[i].setMagicBox(box);
+                isBoxSetup = m_settings.isMultiMode();
+            }
+        }
+    }
+
+    app.getTimeline().addData(gpsDatas, finished);
+
+    if (std::find(finished.begin(), finished.end(), 0) == finished.end())
+    {
+        stop();
+
+        for (size_t i = 0; i < gpsDatas.size(); ++i)
+        {
+            if (loadOk[i] && i < m_cacheKeys.size() && !m_cacheKeys[i].empty())
+            {
+                GpsDataCache::save(m_cacheKeys[i], *gpsDatas[i]);
+            }
+            ofLogNotice(Logger::DATA_LOADER)
+                    << "--> Total data: "
+                    << gpsDatas[i]->getNumSegments() << " GpsSegments, "
+                    << gpsDatas[i]->getTotalGpsPoints() << " GpsPoints!";
+        }
+    }
+
+    return dataAdded;
+}
+
+//------------------------------------------------------------------------------
+
+std::vector<unsigned int> GpsDataStreamLoader::getNumRowsLoaded() const
+{
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    return m_numRows;
+}
+
+//------------------------------------------------------------------------------
+// Called from worker threads
+//------------------------------------------------------------------------------
+
+bool GpsDataStreamLoader::addChunk(const size_t personIndex,
+                                   const LocationMapPtr& locations,
+                                   const GpsSegmentVector& segments,
+                                   const std::string& user)
+{
+    Chunk chunk;
+    chunk.segments = segments;
+    chunk.user = user;
+    chunk.locations = locations;
+    chunk.minLonLat = Utils::getPointDoubleMax();
+    chunk.maxLonLat = Utils::getPointDoubleMin();
+
+    unsigned int numRows = 0;
+    BOOST_FOREACH(const GpsSegment& segment, segments)
+    {
+        BOOST_FOREACH(const GpsPoint& point, segment.getPoints())
+        {
+            chunk.minLonLat.x = MIN(point.getLongitude(), chunk.minLonLat.x);
+            chunk.maxLonLat.x = MAX(point.getLongitude(), chunk.maxLonLat.x);
+            chunk.minLonLat.y = MIN(point.getLatitude(), chunk.minLonLat.y);
+            chunk.maxLonLat.y = MAX(point.getLatitude(), chunk.maxLonLat.y);
+        }
+        numRows += segment.getPoints().size();
+    }
+
+    // Safe on several threads, GeoUtils does not share proj objects
+    // between threads.
+    GpsData::calculateUtmPoints(segments, chunk.utmSegments);
+    GpsData::calculateLod(chunk.utmSegments, chunk.lod);
+
+    // Only an empty chunk is copied under the lock, update() waits for it
+    // on the main thread.
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    m_pending[personIndex].push_back(Chunk());
+    Chunk& pending = m_pending[personIndex].back();
+    pending.segments.swap(chunk.segments);
+    pending.utmSegments.swap(chunk.utmSegments);
+    pending.lod.indices.swap(chunk.lod.indices);
+    pending.lod.offsets.swap(chunk.lod.offsets);
+    pending.minLonLat = chunk.minLonLat;
+    pending.maxLonLat = chunk.maxLonLat;
+    pending.user.swap(chunk.user);
+    pending.locations.swap(chunk.locations);
+    m_numRows[personIndex] += numRows;
+
+    return !m_cancel;
+}
+
+//------------------------------------------------------------------------------
+
+void GpsDataStreamLoader::setFinished(const size_t personIndex,
+                                      const bool loadOk)
+{
+    if (!loadOk)
+    {
+        ofLogNotice(Logger::DATA_LOADER) << "--> No GpsData loaded!";
+    }
+
+    Poco::FastMutex::ScopedLock lock(m_mutex);
+    m_finished[personIndex] = 1;
+    m_loadOk[personIndex] = loadOk;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,98 @@
+/*=======================================================
+ Copyright (c) avp::ptr, 2010
+=======================================================*/
+
+#ifndef _GPSDATASTREAMLOADER_H_
+#define _GPSDATASTREAMLOADER_H_
+
+#include "DrawingLifeIncludes.h"
+#include "DataLoader.h"
+#include "GpsData.h"
+#include "Poco/Mutex.h"
+#include "Poco/ThreadPool.h"
+
+class DrawingLifeApp;
+
+/**
+ * \brief Loads GpsData in the background and hands it over in chunks.
+ *
+ * Every person is queried on its own thread. Read segments are projected on
+ * that thread, with a proj context of its own, and queued. update() appends
+ * the queued chunks to the GpsData and the Timeline on the main thread, so
+ * the animation can start with the data that has already arrived.
+ */
+class GpsDataStreamLoader
+{
+public:
+
+    GpsDataStreamLoader(const AppSettings& settings);
+    ~GpsDataStreamLoader();
+
+    /**
+    * \brief Start loading.
+    * \param funcVec query function per person, persons with an empty
+    * function are already loaded.
+    * \param cacheKeys cache key per person, loaded data is written to the
+    * cache if not empty.
+    * \return false if persons have to be queried but no connection could
+    * be opened. Failed queries show up as empty GpsData when loading ends.
+    */
+    bool start(const std::vector<DataLoader::tFuncLoadGpsData>& funcVec,
+               const StringVec& cacheKeys);
+    void stop();
+
+    /**
+    * \brief Append chunks that arrived since the last call.
+    * \return true if new data was added.
+    */
+    bool update(DrawingLifeApp& app);
+
+    bool isLoading() const { return m_isLoading; }
+
+    std::vector<unsigned int> getNumRowsLoaded() const;
+
+private:
+
+    struct Chunk
+    {
+        GpsSegmentVector segments;
+        UtmDataVector utmSegments;
+        GpsData::LodLevels lod;
+        ofxPoint<double> minLonLat;
+        ofxPoint<double> maxLonLat;
+        std::string user;
+        LocationMapPtr locations;
+    };
+    typedef std::vector<Chunk> ChunkVector;
+
+    class PersonWorker;
+
+    bool addChunk(size_t personIndex,
+                  const LocationMapPtr& locations,
+                  const GpsSegmentVector& segments,
+                  const std::string& user);
+    void setFinished(size_t personIndex, bool loadOk);
+
+    const AppSettings& m_settings;
+
+    boost::ptr_vector<DBReader> m_dbReaders;
+    boost::ptr_vector<PersonWorker> m_workers;
+    boost::scoped_ptr<Poco::ThreadPool> m_threadPool;
+
+    mutable Poco::FastMutex m_mutex;
+    std::vector<ChunkVector> m_pending;
+    std::vector<unsigned int> m_numRows;
+    std::vector<int> m_finished;
+    std::vector<int> m_loadOk;
+    bool m_cancel;
+
+    StringVec m_cacheKeys;
+
+    bool m_isLoading;
+
+    // (prevent copy constructor and operator= being generated..)
+    GpsDataStreamLoader(const GpsDataStreamLoader&);
+    const GpsDataStreamLoader& operator=(const GpsDataStreamLoader&);
+};
+
+#endif // _GPSDATASTREAMLOADER_H_
@@ -16,8 +16,8 @@ class GpsPoint
 	double m_longitude;
 	double m_elevation;
 	double m_speed;
-	std::string m_timestamp;
-	std::string m_location;
+	tEpoch m_time;
+	int m_locationId;
 
 public:
 	GpsPoint()
@@ -27,8 +27,8 @@ public:
 	m_longitude(0.0),
 	m_elevation(0.0),
 	m_speed(0.0),
-	m_timestamp(""),
-	m_location("")
+	m_time(0),
+	m_locationId(0)
     {}
 
     ~GpsPoint(){}
@@ -38,19 +38,19 @@ public:
     * \param latitude
     * \param longitude
     * \param elevation
-    * \param timestamp
-    * \param location
+    * \param time seconds since epoch, see Utils::timestampToEpoch()
+    * \param locationId id of the location in the citydefs table
     */
     void setData(int id, double latitude, double longitude, double elevation,
-                 const std::string& timestamp, const std::string& location,
+                 tEpoch time, int locationId,
                  double speed)
     {
 		m_gpsPointId = id;
 		m_latitude = latitude;
 		m_longitude = longitude;
 		m_elevation = elevation;
-		m_timestamp = timestamp;
-		m_location = location;
+		m_time = time;
+		m_locationId = locationId;
 		m_speed = speed;
 	}
     void setDataFromLatLon(double lat, double lon)
@@ -76,16 +76,16 @@ public:
 	double getElevation() const { return m_elevation; }
 	//---------------------------------------------------------------------------
     /**
-	* \brief Get location for GpsPoint.
-	* \return Location string.
+	* \brief Get location id for GpsPoint.
+	* \return Location id, resolved with the LocationMap of the query.
 	*/
-	const std::string& getLocation() const { return m_location; }
+	int getLocationId() const { return m_locationId; }
 	//---------------------------------------------------------------------------
     /**
-	* \brief Get time stamp for GpsPoint.
-	* \return Timestamp string.
+	* \brief Get time for GpsPoint.
+	* \return Seconds since epoch.
 	*/
-	const std::string& getTimestamp() const { return m_timestamp; }
+	tEpoch getTime() const { return m_time; }
 	// -----------------------------------------------------------------------------
 
 	double getSpeed() const { return m_speed; }
@@ -102,8 +102,8 @@ public:
 		m_latitude = 0;
 		m_longitude = 0;
 		m_elevation = 0;
-		m_timestamp = "";
-		m_location = "";
+		m_time = 0;
+		m_locationId = 0;
 		m_speed= 0.0;
 	}
 };
@@ -9,6 +9,7 @@ const char* Logger::GPS_DATA     = "GpsData";
 const char* Logger::WALK         = "Walk";
 const char* Logger::MAGIC_BOX    = "MagicBox";
 const char* Logger::DATA_LOADER  = "DataLoader";
+const char* Logger::GPS_DATA_CACHE = "GpsDataCache";
 
 void Logger::logValue(const char* function, const char* name, const string& value)
 {
@@ -28,6 +28,7 @@ public:
     static const char* WALK;
     static const char* MAGIC_BOX;
     static const char* DATA_LOADER;
+    static const char* GPS_DATA_CACHE;
 
     static void logValue(const char* function, const char* name, const std::string& value);
     static void logValue(const char* function, const char* name, int value);
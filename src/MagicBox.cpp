@@ -40,6 +40,14 @@ bool MagicBox::isInBox(const ofxPoint<double>& utmPoint) const
 
 //------------------------------------------------------------------------------
 
+UtmBounds MagicBox::getBounds() const
+{
+    return UtmBounds(UtmPoint(m_theBox.getX(), m_theBox.getY()),
+                     UtmPoint(m_theBox.getRight(), m_theBox.getBottom()));
+}
+
+//------------------------------------------------------------------------------
+
 bool MagicBox::isInPaddedBox(const ofxPoint<double>& utmPoint) const
 {
     return m_paddedBox.inside(utmPoint);
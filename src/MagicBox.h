@@ -35,6 +35,7 @@ public:
     void addToBoxSize(double sizeToAdd);
 
     const ofxRectangle<double>& getTheBox() const { return m_theBox; }
+    UtmBounds getBounds() const;
     const ofxRectangle<double> getNormalizedBox() const;
     const ofxRectangle<double>& getPaddedBox() const { return m_theBox; }
     const ofxRectangle<double> getNormalizedPaddedBox() const;
@@ -14,7 +14,8 @@ m_last(NULL),
 m_counter(0),
 m_indexToUpdate(0),
 m_lastUpdatedTimelineId(0),
-m_currentCountWasUpdated(false)
+m_currentCountWasUpdated(false),
+m_isComplete(true)
 {
     //ctor
 }
@@ -32,27 +33,21 @@ void Timeline::setData(const GpsDataVector& gpsDatas)
 {
     m_counter = 0;
     m_timeline.clear();
-    int userIndex = 0;
+    m_addCursors.assign(gpsDatas.size(), 0);
+    m_isSorted.assign(gpsDatas.size(), 1);
+    m_unsortedPositions.assign(gpsDatas.size(), std::vector<unsigned int>());
+    m_gpsDatas.assign(gpsDatas.begin(), gpsDatas.end());
+    m_isComplete = true;
+
+    size_t numPoints = 0;
     BOOST_FOREACH(const GpsDataPtr gpsData, gpsDatas)
     {
-        BOOST_FOREACH(const GpsSegment& gpsSegment, gpsData->getSegments())
-        {
-            BOOST_FOREACH(const GpsPoint& gpsPoint, gpsSegment.getPoints())
-            {
-                std::string timeString = gpsPoint.getTimestamp();
-                TimelineObject tmObj;
-                tmObj.timeString = timeString;
-                tmObj.secs = makeTimeObject(timeString);
-                tmObj.id = userIndex;
-                tmObj.gpsid = gpsPoint.getGpsPointId();
-                m_timeline.push_back(tmObj);
-//                ofLog(OF_LOG_VERBOSE, "%s : %d : %li\n", tmObj.timeString.c_str(), tmObj.id, tmObj.secs);
-            }
-        }
-        ++userIndex;
+        numPoints += gpsData->getTotalGpsPoints();
     }
+    m_timeline.reserve(numPoints);
+
+    mergeTimeline(gpsDatas, false, 0, m_timeline);
 
-    sortTimeline();
     try
     {
         m_current = &m_timeline.at(0);
@@ -62,6 +57,67 @@ void Timeline::setData(const GpsDataVector& gpsDatas)
 
 //------------------------------------------------------------------------------
 
+void Timeline::addData(const GpsDataVector& gpsDatas,
+                       const std::vector<int>& finished)
+{
+    m_addCursors.resize(gpsDatas.size(), 0);
+    m_isSorted.resize(gpsDatas.size(), 1);
+    m_unsortedPositions.resize(gpsDatas.size());
+    m_gpsDatas.assign(gpsDatas.begin(), gpsDatas.end());
+
+    // Points of a still loading person arrive in time order, so nothing
+    // earlier than its last loaded point can follow.
+    bool hasLimit = false;
+    tEpoch limit = 0;
+    bool allFinished = true;
+    for (size_t i = 0; i < gpsDatas.size(); ++i)
+    {
+        if (i < finished.size() && finished[i])
+        {
+            continue;
+        }
+        allFinished = false;
+
+        const ArrayView<tEpoch> times = gpsDatas[i]->getTimes();
+        if (times.empty())
+        {
+            return;
+        }
+        const tEpoch last = times[times.size() - 1];
+        if (!hasLimit || last < limit)
+        {
+            limit = last;
+            hasLimit = true;
+        }
+    }
+
+    // m_last points into m_timeline and would not survive reallocation.
+    const size_t lastIndex = m_last ? m_last - &m_timeline[0] : 0;
+
+    // Everything already in the timeline is not later than the limit of the
+    // last call, so the merged points are appended in order.
+    const size_t oldSize = m_timeline.size();
+    mergeTimeline(gpsDatas, hasLimit, limit, m_timeline);
+
+    if (m_timeline.size() > oldSize)
+    {
+        m_current = &m_timeline[std::min<size_t>(m_counter,
+                                                 m_timeline.size() - 1)];
+        if (m_last)
+        {
+            m_last = &m_timeline[lastIndex];
+        }
+    }
+
+    m_isComplete = allFinished;
+    if (m_isComplete && !m_timeline.empty())
+    {
+        m_counter %= m_timeline.size();
+    }
+}
+
+//------------------------------------------------------------------------------
+
 void Timeline::countUp()
 {
     if (m_currentCountWasUpdated)
@@ -69,7 +125,81 @@ void Timeline::countUp()
         m_lastUpdatedTimelineId = m_counter;
     }
     ++m_counter;
-    m_counter %= m_timeline.size();
+    // While data is still added, the counter waits at the end for more.
+    if (m_isComplete)
+    {
+        m_counter %= m_timeline.size();
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void Timeline::seekToIndex(const unsigned int index)
+{
+    if (m_timeline.empty())
+    {
+        return;
+    }
+    m_counter = std::min<unsigned int>(index, m_timeline.size());
+    m_current = &m_timeline[std::min<size_t>(m_counter, m_timeline.size() - 1)];
+    m_last = NULL;
+    m_lastUpdatedTimelineId = m_counter;
+    m_currentCountWasUpdated = false;
+}
+
+//------------------------------------------------------------------------------
+
+void Timeline::seekToTime(const tEpoch time)
+{
+    TimelineObject key;
+    key.secs = time;
+    const TimelineObjectVec::const_iterator it =
+        std::lower_bound(m_timeline.begin(), m_timeline.end(), key,
+                         TimelineObject());
+    seekToIndex(static_cast<unsigned int>(it - m_timeline.begin()));
+}
+
+//------------------------------------------------------------------------------
+
+size_t Timeline::getNumPointsBefore(const int person) const
+{
+    if (person < 0 || static_cast<size_t>(person) >= m_addCursors.size())
+    {
+        return 0;
+    }
+    if (!hasCurrent())
+    {
+        // All added points are before the end.
+        return m_addCursors[person];
+    }
+
+    if (!m_isSorted[person])
+    {
+        // The sorted timeline does not follow the point order of the
+        // person, but the walk takes one point per entry.
+        const std::vector<unsigned int>& positions = m_unsortedPositions[person];
+        return std::lower_bound(positions.begin(), positions.end(), m_counter) -
+               positions.begin();
+    }
+
+    const TimelineObject& current = m_timeline[m_counter];
+    if (current.id == person)
+    {
+        return current.pointIndex;
+    }
+
+    const GpsDataPtr gpsData = m_gpsDatas[person].lock();
+    if (!gpsData)
+    {
+        return 0;
+    }
+    // Points of a person are sorted by time, equal times are merged in
+    // person order.
+    const ArrayView<tEpoch> times = gpsData->getTimes();
+    const ArrayView<tEpoch>::const_iterator it = person < current.id
+        ? std::upper_bound(times.begin(), times.end(), current.secs)
+        : std::lower_bound(times.begin(), times.end(), current.secs);
+    return std::min<size_t>(it - times.begin(), m_addCursors[person]);
 }
 
 //------------------------------------------------------------------------------
@@ -109,6 +239,13 @@ bool Timeline::isTimelineIndex(unsigned int index)
 
 //------------------------------------------------------------------------------
 
+bool Timeline::hasCurrent() const
+{
+    return m_counter < m_timeline.size();
+}
+
+//------------------------------------------------------------------------------
+
 bool Timeline::isNextReady()
 {
 //    bool ready = true;
@@ -147,12 +284,13 @@ bool Timeline::isNextReady()
 
 std::string Timeline::getCurrentTime() const
 {
-    const std::string& timeString = m_timeline[m_counter].timeString;
+    if (!hasCurrent())
+    {
+        return std::string();
+    }
     int year, month, day, hour, min, sec;
-//    sscanf(timeString.c_str(), "%d-%d-%dT%d:%d:%dZ",
-//           &year, &month, &day, &hour, &min, &sec);
-    sscanf(timeString.c_str(), "%d-%d-%d %d:%d:%d",
-           &year, &month, &day, &hour, &min, &sec);
+    Utils::epochToDateTime(m_timeline[m_counter].secs,
+                           year, month, day, hour, min, sec);
     char buf[25];
     sprintf(buf, "%02d:%02d:%02d", hour, min, sec);
     return string(buf);
@@ -182,32 +320,159 @@ const TimelineObject& Timeline::getCurrentTimelineObj() const
 
 //------------------------------------------------------------------------------
 
-time_t Timeline::makeTimeObject(const std::string& timeString)
+int Timeline::getCurrentGpsPointId() const
 {
-    struct tm tm;
-    time_t t;
-    time(&t);
-    int year, month, day, hour, min, sec;
-//    sscanf(str.c_str(), "%d-%d-%dT%d:%d:%dZ", &year, &month, &day, &hour, &min, &sec);
-    sscanf(timeString.c_str(), "%d-%d-%d %d:%d:%d", &year, &month, &day, &hour, &min, &sec);
-    tm = *localtime(&t);
-    tm.tm_year = year - 1900;
-    tm.tm_mon = month - 1;
-//    tm.tm_mon = month;
-    tm.tm_mday = day;
-    tm.tm_hour = hour;
-    tm.tm_min = min;
-    tm.tm_sec = sec;
-    tm.tm_isdst = -1;
-    t = mktime(&tm);
-    return t;
+    if (!hasCurrent())
+    {
+        return -1;
+    }
+    const TimelineObject& tmObj = m_timeline[m_counter];
+    try
+    {
+        if (const GpsDataPtr gpsData = m_gpsDatas.at(tmObj.id).lock())
+        {
+            const ArrayView<int> ids = gpsData->getGpsPointIds();
+            if (tmObj.pointIndex < ids.size())
+            {
+                return ids[tmObj.pointIndex];
+            }
+        }
+    }
+    catch (const std::out_of_range&) {}
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+
+/// Next point of one person in the merge.
+struct MergeHead
+{
+    tEpoch secs;
+    int person;
+    size_t index;
+
+    // Earliest point on top of the heap, ties in person order.
+    bool operator<(const MergeHead& rhs) const
+    {
+        return secs != rhs.secs ? secs > rhs.secs : person > rhs.person;
+    }
+};
+
+//------------------------------------------------------------------------------
+
+bool Timeline::findGpsPointId(const int gpsPointId,
+                              const unsigned int begin,
+                              unsigned int& index) const
+{
+    // Locked once, not for every entry.
+    std::vector<GpsDataPtr> gpsDatas;
+    std::vector<ArrayView<int> > ids;
+    BOOST_FOREACH(const GpsDataWeak& gpsDataWeak, m_gpsDatas)
+    {
+        gpsDatas.push_back(gpsDataWeak.lock());
+        ids.push_back(gpsDatas.back() ? gpsDatas.back()->getGpsPointIds()
+                                      : ArrayView<int>());
+    }
+
+    for (unsigned int i = begin; i < m_timeline.size(); ++i)
+    {
+        const TimelineObject& tmObj = m_timeline[i];
+        if (static_cast<size_t>(tmObj.id) < ids.size() &&
+            tmObj.pointIndex < ids[tmObj.id].size() &&
+            ids[tmObj.id][tmObj.pointIndex] == gpsPointId)
+        {
+            index = i;
+            return true;
+        }
+    }
+    return false;
 }
 
 //------------------------------------------------------------------------------
 
-void Timeline::sortTimeline()
+void Timeline::mergeTimeline(const GpsDataVector& gpsDatas,
+                             const bool hasLimit,
+                             const tEpoch limit,
+                             TimelineObjectVec& timeline)
 {
-    std::sort(m_timeline.begin(), m_timeline.end(), TimelineObject());
+    // Points of each person come from the database ordered by time, so the
+    // per person streams only need to be merged, O(N log P).
+    std::vector<MergeHead> heap;
+    heap.reserve(gpsDatas.size());
+    const std::vector<int> wasSorted(m_isSorted);
+    bool isSorted = true;
+    for (size_t i = 0; i < gpsDatas.size(); ++i)
+    {
+        const ArrayView<tEpoch> times = gpsDatas[i]->getTimes();
+        const size_t cursor = m_addCursors[i];
+        // Also against the last added point.
+        for (size_t j = MAX(cursor, 1); j < times.size() && m_isSorted[i]; ++j)
+        {
+            m_isSorted[i] = times[j - 1] <= times[j];
+        }
+        isSorted = isSorted && m_isSorted[i];
+        if (cursor < times.size() && (!hasLimit || times[cursor] <= limit))
+        {
+            const MergeHead head = { times[cursor], static_cast<int>(i), cursor };
+            heap.push_back(head);
+        }
+    }
+    std::make_heap(heap.begin(), heap.end());
+
+    const size_t mergeStart = timeline.size();
+    while (!heap.empty())
+    {
+        std::pop_heap(heap.begin(), heap.end());
+        MergeHead& head = heap.back();
+
+        TimelineObject tmObj;
+        tmObj.secs = head.secs;
+        tmObj.id = head.person;
+        tmObj.pointIndex = static_cast<unsigned int>(head.index);
+        timeline.push_back(tmObj);
+
+        const ArrayView<tEpoch> times = gpsDatas[head.person]->getTimes();
+        ++head.index;
+        m_addCursors[head.person] = head.index;
+        if (head.index < times.size() &&
+            (!hasLimit || times[head.index] <= limit))
+        {
+            head.secs = times[head.index];
+            std::push_heap(heap.begin(), heap.end());
+        }
+        else
+        {
+            heap.pop_back();
+        }
+    }
+
+    if (!isSorted)
+    {
+        // Custom sql queries don't have to be ordered by time.
+        ofLogWarning("Timeline", "GpsData not ordered by time, sorting timeline");
+        std::stable_sort(timeline.begin() + mergeStart, timeline.end(),
+                         TimelineObject());
+
+        // Entries before mergeStart keep their positions, only a person
+        // that was sorted until now needs them from the start.
+        size_t positionStart = mergeStart;
+        for (size_t i = 0; i < m_isSorted.size(); ++i)
+        {
+            if (wasSorted[i] && !m_isSorted[i])
+            {
+                positionStart = 0;
+            }
+        }
+        for (size_t j = positionStart; j < timeline.size(); ++j)
+        {
+            const int person = timeline[j].id;
+            if (!m_isSorted[person] && (j >= mergeStart || wasSorted[person]))
+            {
+                m_unsortedPositions[person].push_back(
+                    static_cast<unsigned int>(j));
+            }
+        }
+    }
 }
 
 //------------------------------------------------------------------------------
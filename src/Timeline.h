@@ -22,14 +22,48 @@ public:
 
     void setData(const GpsDataVector& gpsDatas);
 
+    /**
+    * \brief Append points that were added to the GpsData since the last call.
+    *
+    * Points are only appended up to the latest timestamp all still loading
+    * persons have reached, so the timeline stays sorted.
+    * \param gpsDatas GpsData of all persons.
+    * \param finished per person, nonzero if its data is loaded completely.
+    */
+    void addData(const GpsDataVector& gpsDatas,
+                 const std::vector<int>& finished);
+
     void countUp();
 
+    /**
+    * \brief Move the counter to a timeline index.
+    * \param index timeline index, clamped to the timeline. The size of the
+    * timeline is allowed and means that all points are shown.
+    */
+    void seekToIndex(unsigned int index);
+    /**
+    * \brief Move the counter to the first point not earlier than time.
+    *
+    * Binary search over the sorted timeline.
+    * \param time seconds since epoch.
+    */
+    void seekToTime(tEpoch time);
+    /**
+    * \brief Get the number of points of a person before the counter.
+    *
+    * O(log n), used to set the Walk cursors after a seek.
+    * \param person person index.
+    */
+    size_t getNumPointsBefore(int person) const;
+
     int getCurrentId() const;
 
     bool isLast() const;
     bool isFirst() const;
     bool isTimelineIndex(unsigned int index);
     bool isNextReady();
+    bool hasCurrent() const;
+    bool isComplete() const { return m_isComplete; }
 
     const TimelineObjectVec& getTimeline() const { return m_timeline; }
     inline unsigned int getNumberToUpdate() const;
@@ -37,20 +71,36 @@ public:
     unsigned int getCurrentCount() const;
     unsigned int getAllCount() const;
     const TimelineObject& getCurrentTimelineObj() const;
-
-private:
-    // -------------------------------------------------------------------------
     /**
-    * \brief Get unix time for a given time string.
-    * \param timeString time string.
-    * \return time_t value.
+    * \brief Get the database id of the current point.
+    * \return id or -1 if there is no current point.
+    */
+    int getCurrentGpsPointId() const;
+    /**
+    * \brief Find the timeline index of a point by its database id.
+    *
+    * Linear search from begin on.
+    * \param gpsPointId database id of the point.
+    * \param begin first timeline index to look at.
+    * \param index timeline index of the point, if found.
+    * \return false if no point from begin on has the id.
     */
-    time_t makeTimeObject(const std::string& timeString);
+    bool findGpsPointId(int gpsPointId, unsigned int begin,
+                        unsigned int& index) const;
 
+private:
+    // -------------------------------------------------------------------------
     /**
-    * \brief Sort timeline objects.
+    * \brief Merge the not yet added points of all persons into timeline.
+    * \param gpsDatas GpsData of all persons.
+    * \param hasLimit only merge points up to limit.
+    * \param limit latest time to merge.
+    * \param timeline timeline to append to.
     */
-    void sortTimeline();
+    void mergeTimeline(const GpsDataVector& gpsDatas,
+                       bool hasLimit,
+                       tEpoch limit,
+                       TimelineObjectVec& timeline);
     // -------------------------------------------------------------------------
     TimelineObjectVec m_timeline;
 
@@ -65,6 +115,20 @@ private:
 
     bool m_currentCountWasUpdated;
 
+    bool m_isComplete;
+
+    /// GpsData the timeline points refer to, by person index.
+    std::vector<GpsDataWeak> m_gpsDatas;
+
+    /// Per person index of the next point to add.
+    std::vector<size_t> m_addCursors;
+
+    /// Per person, nonzero while its added points are ordered by time.
+    std::vector<int> m_isSorted;
+
+    /// Per person not ordered by time, its timeline indices in order.
+    std::vector<std::vector<unsigned int> > m_unsortedPositions;
+
     // (prevent copy constructor and operator= being generated..)
     Timeline (const Timeline&);
     const Timeline& operator= (const Timeline&);
@@ -61,6 +61,104 @@ ofxPoint<double> Utils::getPointDoubleMax()
                             std::numeric_limits<double>::max());
 }
 
+//------------------------------------------------------------------------------
+// Days since 1970-01-01 for a date of the proleptic gregorian calendar and
+// back, so no time zone or locale functions are involved.
+//------------------------------------------------------------------------------
+
+static tEpoch daysFromCivil(int year, const int month, const int day)
+{
+    year -= month <= 2;
+    const tEpoch era = (year >= 0 ? year : year - 399) / 400;
+    const tEpoch yearOfEra = year - era * 400;
+    const tEpoch dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5
+            + day - 1;
+    const tEpoch dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100
+            + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+static void civilFromDays(tEpoch days, int& year, int& month, int& day)
+{
+    days += 719468;
+    const tEpoch era = (days >= 0 ? days : days - 146096) / 146097;
+    const tEpoch dayOfEra = days - era * 146097;
+    const tEpoch yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524
+                              - dayOfEra / 146096) / 365;
+    const tEpoch dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4
+                                         - yearOfEra / 100);
+    const tEpoch mp = (5 * dayOfYear + 2) / 153;
+    day = static_cast<int>(dayOfYear - (153 * mp + 2) / 5 + 1);
+    month = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+    year = static_cast<int>(yearOfEra + era * 400 + (month <= 2));
+}
+
+//------------------------------------------------------------------------------
+
+tEpoch Utils::timestampToEpoch(const char* timestamp)
+{
+    // year, month, day, hour, minute, second
+    int fields[6] = { 1970, 1, 1, 0, 0, 0 };
+    const char* pos = timestamp;
+    for (int i = 0; i < 6; ++i)
+    {
+        if (*pos < '0' || *pos > '9')
+        {
+            break;
+        }
+        int value = 0;
+        for (; *pos >= '0' && *pos <= '9'; ++pos)
+        {
+            value = value * 10 + (*pos - '0');
+        }
+        fields[i] = value;
+        // Skip the separator ('-', ' ', 'T' or ':').
+        if (*pos != '\0')
+        {
+            ++pos;
+        }
+    }
+    return daysFromCivil(fields[0], fields[1], fields[2]) * 86400
+            + fields[3] * 3600 + fields[4] * 60 + fields[5];
+}
+
+//------------------------------------------------------------------------------
+
+tEpoch Utils::timestampToEpoch(const std::string& timestamp)
+{
+    return timestampToEpoch(timestamp.c_str());
+}
+
+//------------------------------------------------------------------------------
+
+void Utils::epochToDateTime(const tEpoch epoch, int& year, int& month,
+                            int& day, int& hour, int& min, int& sec)
+{
+    tEpoch days = epoch / 86400;
+    tEpoch secs = epoch % 86400;
+    if (secs < 0)
+    {
+        secs += 86400;
+        --days;
+    }
+    civilFromDays(days, year, month, day);
+    hour = static_cast<int>(secs / 3600);
+    min = static_cast<int>(secs / 60 % 60);
+    sec = static_cast<int>(secs % 60);
+}
+
+//------------------------------------------------------------------------------
+
+std::string Utils::epochToTimestamp(const tEpoch epoch)
+{
+    int year, month, day, hour, min, sec;
+    epochToDateTime(epoch, year, month, day, hour, min, sec);
+    char buf[32];
+    sprintf(buf, "%04d-%02d-%02d %02d:%02d:%02d",
+            year, month, day, hour, min, sec);
+    return std::string(buf);
+}
+
 //------------------------------------------------------------------------------
 
 const std::string Utils::getCurrentGpsInfo(const GpsData& gpsData,
@@ -69,12 +167,9 @@ const std::string Utils::getCurrentGpsInfo(const GpsData& gpsData,
     std::string gpsInfo;
     if (gpsData.getTotalGpsPoints() > 0)
     {
-        std::string timeString = walk.getCurrentTimestamp();
         int year, month, day, hour, min, sec;
-//        sscanf(timeString.c_str(), "%d-%d-%dT%d:%d:%dZ",
-//               &year, &month, &day, &hour, &min, &sec);
-        sscanf(timeString.c_str(), "%d-%d-%d %d:%d:%d",
-               &year, &month, &day, &hour, &min, &sec);
+        epochToDateTime(walk.getCurrentTime(),
+                        year, month, day, hour, min, sec);
         char buf[25];
         sprintf(buf, "%02d.%02d.%d %02d:%02d:%02d",
                 day, month, year, hour, min, sec);
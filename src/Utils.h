@@ -15,6 +15,24 @@ public:
     static ofxPoint<double> getPointDoubleMin();
     static ofxPoint<double> getPointDoubleMax();
 
+    /**
+    * \brief Convert a timestamp "YYYY-MM-DD hh:mm:ss" to seconds since epoch.
+    *
+    * Parses the fixed format by hand, without locale or time zone functions.
+    * The timestamp is taken as UTC, 'T' as date/time separator is accepted.
+    */
+    static tEpoch timestampToEpoch(const char* timestamp);
+    static tEpoch timestampToEpoch(const std::string& timestamp);
+    /**
+    * \brief Split seconds since epoch into date and time.
+    */
+    static void epochToDateTime(tEpoch epoch, int& year, int& month, int& day,
+                                int& hour, int& min, int& sec);
+    /**
+    * \brief Convert seconds since epoch back to "YYYY-MM-DD hh:mm:ss".
+    */
+    static std::string epochToTimestamp(tEpoch epoch);
+
     static const std::string getCurrentGpsInfo(const GpsData& gpsData,
                                                const Walk& walk);
     static const std::string getCurrentGpsInfoDebug(const GpsData& gpsData,
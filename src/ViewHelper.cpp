@@ -22,6 +22,30 @@ void ViewHelper::drawFPS()
 
 //------------------------------------------------------------------------------
 
+void ViewHelper::drawLoadingInfo(const StringVec& names,
+                                 const std::vector<unsigned int>& numRows)
+{
+    ofSetHexColor(0xffffff);
+    std::stringstream stream;
+    stream << "Loading GpsData...\n";
+    for (size_t i = 0; i < numRows.size(); ++i)
+    {
+        if (i < names.size())
+        {
+            stream << names[i];
+        }
+        else
+        {
+            stream << "Person " << i + 1;
+        }
+        stream << ": " << numRows[i] << " points\n";
+    }
+    ofDrawBitmapString(stream.str(), 30.0,
+                       ofGetHeight() - 60 - 14 * numRows.size());
+}
+
+//------------------------------------------------------------------------------
+
 void ViewHelper::drawKeyCommands(const ofColor& c)
 {
     ofSetColor(c);
@@ -212,7 +236,8 @@ void ViewHelper::drawInfoMultiMode(const AppSettings& settings,
 {
     ofSetColor(255, 255, 255, settings.getAlphaLegend());
     ofSetHexColor(0xffffff);
-    const std::string& infoText = timeline.getCurrentTime();
+    // Formatted from the epoch of the current point, only when drawn.
+    const std::string infoText = timeline.getCurrentTime();
     const_cast<ofTrueTypeFont&>(font).drawString(infoText,
                                                  viewDimensions.padding,
                                                  viewDimensions.offset.y + 10);
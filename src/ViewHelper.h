@@ -10,6 +10,8 @@ class ViewHelper
 public:
 
     static void drawFPS();
+    static void drawLoadingInfo(const StringVec& names,
+                                const std::vector<unsigned int>& numRows);
     static void drawKeyCommands(const ofColor& c);
     static void drawStartScreen(const ofTrueTypeFont& fontTitle,
                                 const ofTrueTypeFont& fontAuthor);
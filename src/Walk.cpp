@@ -13,6 +13,154 @@ int Walk::m_dotAlpha = 127;
 
 //------------------------------------------------------------------------------
 
+enum tBoundsState
+{
+    BOUNDS_OUTSIDE, BOUNDS_PARTIAL, BOUNDS_INSIDE
+};
+
+static tBoundsState getBoundsState(const UtmBounds& bounds,
+                                   const UtmBounds& box)
+{
+    if (!bounds.intersects(box))
+    {
+        return BOUNDS_OUTSIDE;
+    }
+    return bounds.isInside(box) ? BOUNDS_INSIDE : BOUNDS_PARTIAL;
+}
+
+#ifndef USE_OPENGL_FIXED_FUNCTIONS
+ofShader Walk::m_trackShader;
+bool Walk::m_isTrackShaderSetup = false;
+bool Walk::m_isTrackShaderLoaded = false;
+bool Walk::m_isTrailBatchActive = false;
+
+//------------------------------------------------------------------------------
+
+/// Tracks with less points are built on the GL thread.
+static const size_t MIN_POINTS_FOR_TRACK_WORKER = 100000;
+
+/// Location of the speed attribute of the track VBO. 1 is not aliased by
+/// the fixed function attributes the track uses.
+static const int TRACK_SPEED_ATTRIBUTE = 1;
+
+//------------------------------------------------------------------------------
+// Built-in track shader. Vertices are relative to the center of the data,
+// the MagicBox and ViewDimensions transform is done here:
+// screen = viewOffset + (vertex + trackOrigin) / boxSize * viewScale
+// Speed colors are picked per vertex, lines to a point with a transparent
+// speed color are discarded like in the fixed function path.
+//------------------------------------------------------------------------------
+
+static const char* trackVertexShader = "#version 120\n" STRINGIFY(
+    uniform vec2 trackOrigin;
+    uniform vec2 boxSize;
+    uniform vec2 viewOffset;
+    uniform vec2 viewScale;
+    uniform int useSpeed;
+    uniform float speedThreshold;
+    uniform vec4 speedColorAbove;
+    uniform vec4 speedColorUnder;
+
+    attribute float speed;
+
+    varying float hidden;
+
+    void main()
+    {
+        vec2 normalized = (gl_Vertex.xy + trackOrigin) / boxSize;
+        vec2 screen = viewOffset + normalized * viewScale;
+        gl_Position = gl_ModelViewProjectionMatrix * vec4(screen, 0.0, 1.0);
+
+        vec4 color = gl_Color;
+        if (useSpeed != 0)
+        {
+            color = speed > speedThreshold ? speedColorAbove : speedColorUnder;
+        }
+        hidden = color.a == 0.0 ? 1.0 : 0.0;
+        gl_FrontColor = color;
+    }
+);
+
+static const char* trackFragmentShader = "#version 120\n" STRINGIFY(
+    varying float hidden;
+
+    void main()
+    {
+        if (hidden > 0.0)
+        {
+            discard;
+        }
+        gl_FragColor = gl_Color;
+    }
+);
+
+//------------------------------------------------------------------------------
+
+/// True if a shader of the app, e.g. the effect shader, is bound.
+static bool isProgramBound()
+{
+    GLint currentProgram = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram);
+    return currentProgram != 0;
+}
+
+//------------------------------------------------------------------------------
+
+/**
+ * \brief Builds the track VBO arrays of new points on a worker thread.
+ *
+ * Works on a copy of the points from begin on, stream chunks are added to
+ * the GpsData meanwhile.
+ */
+class Walk::TrackWorker : public Poco::Runnable
+{
+public:
+
+    TrackWorker(const GpsData& gpsData,
+                const size_t begin,
+                const UtmPoint& origin,
+                const AppSettings& settings)
+        : m_utmPoints(gpsData.getUtmPoints().begin() + begin,
+                      gpsData.getUtmPoints().end()),
+          m_origin(origin),
+          m_settings(settings),
+          m_done(false)
+    {
+        m_track.numSegments = gpsData.getNumSegments();
+        if (settings.useSpeed())
+        {
+            m_speeds.assign(gpsData.getSpeeds().begin() + begin,
+                            gpsData.getSpeeds().end());
+        }
+    }
+
+    void run()
+    {
+        Walk::buildTrackVertices(
+            UtmSegmentView(&m_utmPoints[0], m_utmPoints.size()),
+            ArrayView<double>(m_speeds.empty() ? 0 : &m_speeds[0],
+                              m_speeds.size()),
+            m_origin, m_settings, m_track);
+        m_done.set();
+    }
+
+    bool isDone() { return m_done.tryWait(0); }
+
+    const TrackVertices& getTrack() const { return m_track; }
+
+private:
+
+    std::vector<UtmPoint> m_utmPoints;
+    std::vector<double> m_speeds;
+    UtmPoint m_origin;
+    const AppSettings& m_settings;
+    TrackVertices m_track;
+    Poco::Event m_done;
+};
+#endif
+
+//------------------------------------------------------------------------------
+
 Walk::Walk(const AppSettings& settings, ofColor dotColor)
 :
 DrawingLifeDrawable(),
@@ -24,8 +172,23 @@ m_firstPoint(true),
 m_currentPointIsImage(false),
 m_interactiveMode(false),
 m_drawTraced(true),
-m_imageAlpha(255)
+m_imageAlpha(255),
+m_isTrailDrawn(false),
+m_drawStartSeg(0),
+m_drawStartPoint(0)
 {
+#ifndef USE_OPENGL_FIXED_FUNCTIONS
+    m_numTrackPoints = 0;
+    m_numTrackSegments = 0;
+    m_frontTrackVbo = 0;
+    m_trackCapacity = 0;
+    m_isTrackShaderActive = false;
+    m_trailStartSeg = 0;
+    m_numTracedSegs = -1;
+    m_isTraceUsed = false;
+    m_lodVbos.resize(GpsData::NUM_LOD_LEVELS);
+    m_numLodPoints.assign(GpsData::NUM_LOD_LEVELS, 0);
+#endif
     m_maxPointsToDraw = m_settings.getWalkLength();
     m_dotColor = dotColor;
 
@@ -54,6 +217,9 @@ m_imageAlpha(255)
 Walk::~Walk()
 {
     ofLogVerbose(Logger::WALK, "destroying");
+#ifndef USE_OPENGL_FIXED_FUNCTIONS
+    waitForTrackWorker();
+#endif
     m_image.clear();
 }
 
@@ -69,11 +235,14 @@ void Walk::update()
         return;
     }
 
-    const UtmDataVector& utmPoints= gpsData->getUTMPoints();
-    const UtmSegment& utmSegment = utmPoints[m_currentGpsSegment];
-
-    const int numSegments = static_cast<int>(utmPoints.size());
-    const int numPoints = static_cast<int>(utmSegment.size());
+    const int numSegments = static_cast<int>(gpsData->getNumSegments());
+    if (numSegments == 0)
+    {
+        // Data is not loaded yet.
+        return;
+    }
+    const int numPoints = static_cast<int>(
+        gpsData->getNumPoints(std::min(m_currentGpsSegment, numSegments - 1)));
 
     if (m_currentGpsSegment < numSegments)
     {
@@ -137,9 +306,7 @@ void Walk::updateToSegment(const tWalkDirection direction)
         return;
     }
 
-    const UtmDataVector& utmPoints = gpsData->getUTMPoints();
-
-    const int numSegments = static_cast<int>(utmPoints.size());
+    const int numSegments = static_cast<int>(gpsData->getNumSegments());
 
     if (gpsData->getTotalGpsPoints() > 0 && numSegments > 0)
     {
@@ -161,8 +328,8 @@ void Walk::updateToSegment(const tWalkDirection direction)
                 }
                 --m_currentGpsSegment;
             }
-            const UtmSegment& utmSegment = utmPoints[m_currentGpsSegment];
-            m_currentGpsPoint = static_cast<int>(utmSegment.size()) - 1;
+            m_currentGpsPoint =
+                static_cast<int>(gpsData->getNumPoints(m_currentGpsSegment)) - 1;
             m_currentPoint += m_currentGpsPoint;
         }
         else
@@ -184,12 +351,47 @@ void Walk::reset()
     m_firstPoint = true;
 }
 
+// -----------------------------------------------------------------------------
+
+void Walk::seek(const size_t numPoints)
+{
+    reset();
+
+    const GpsDataPtr gpsData = m_gpsData.lock();
+    if (!gpsData || numPoints == 0)
+    {
+        return;
+    }
+
+    const size_t totalPoints = static_cast<size_t>(gpsData->getTotalGpsPoints());
+    const size_t index = std::min(numPoints, totalPoints) - 1;
+    size_t segment, point;
+    if (gpsData->getSegmentAndPoint(index, segment, point))
+    {
+        m_currentGpsSegment = static_cast<int>(segment);
+        m_currentGpsPoint = static_cast<int>(point);
+        m_currentPoint = static_cast<int>(index + 1);
+        m_firstPoint = false;
+    }
+}
+
 // -----------------------------------------------------------------------------
 // Draw functions
 // -----------------------------------------------------------------------------
 
 void Walk::draw()
 {
+    prepareDraw();
+    drawTrail();
+    drawOverlay();
+}
+
+// -----------------------------------------------------------------------------
+
+void Walk::prepareDraw()
+{
+    m_isTrailDrawn = false;
+
     const GpsDataPtr gpsData = m_gpsData.lock();
     const MagicBoxPtr magicBox = m_magicBox.lock();
     if (!gpsData || !magicBox)
@@ -197,119 +399,67 @@ void Walk::draw()
         return;
     }
 
-    const UtmDataVector& utmData = gpsData->getUTMPoints();
-    if (m_currentGpsSegment >= static_cast<int>(utmData.size()))
+    if (m_currentGpsSegment >= static_cast<int>(gpsData->getNumSegments()) ||
+        m_currentGpsPoint >=
+        static_cast<int>(gpsData->getNumPoints(m_currentGpsSegment)))
     {
         return;
     }
-    const UtmSegment& currentSegment = utmData[m_currentGpsSegment];
 
-    if (utmData.size() > 0 &&
-        currentSegment.size() > 0 &&
-        m_currentGpsPoint < static_cast<int>(currentSegment.size()))
+    if (!m_interactiveMode &&
+        !m_settings.isMultiMode() &&
+        !m_settings.isBoundingBoxFixed())
     {
-        // ---------------------------------------------------------------------
-        // Draw Gps data
-        // ---------------------------------------------------------------------
-        const UtmPoint& currentUtm = currentSegment[m_currentGpsPoint];
-
-        if (!m_interactiveMode &&
-            !m_settings.isMultiMode() &&
-            !m_settings.isBoundingBoxFixed())
-        {
-            magicBox->updateBoxIfNeeded(currentUtm);
-        }
-
-        int startSeg, startPoint;
-        boost::tie(startSeg, startPoint) =
-            calculateStartSegmentAndStartPoint(*gpsData);
+        magicBox->updateBoxIfNeeded(gpsData->getUtm(m_currentGpsSegment,
+                                                     m_currentGpsPoint));
+    }
 
-        if (m_interactiveMode && !m_drawTraced)
-        {
-            startSeg = m_currentGpsSegment;
-        }
+    boost::tie(m_drawStartSeg, m_drawStartPoint) =
+        calculateStartSegmentAndStartPoint(*gpsData);
 
-        for (int i = startSeg; i <= m_currentGpsSegment; ++i)
-        {
-            const UtmSegment& segment = utmData[i];
-#ifdef USE_OPENGL_FIXED_FUNCTIONS
-            glBegin(GL_LINE_STRIP);
-            ofSetColor(m_fgColor);
-#else
-            PointsAndColors pts;
-            ofColor currentColor = m_fgColor;
-#endif
+    if (m_interactiveMode && !m_drawTraced)
+    {
+        m_drawStartSeg = m_currentGpsSegment;
+    }
 
-            int pointEnd;
-            if (i == m_currentGpsSegment)
-            {
-                pointEnd = m_currentGpsPoint;
-                if (m_interactiveMode && m_drawTraced)
-                {
-#ifdef USE_OPENGL_FIXED_FUNCTIONS
-                    ofSetColor(m_currentSegColor);
-#else
-                    currentColor = m_currentSegColor;
+#ifndef USE_OPENGL_FIXED_FUNCTIONS
+    if (!prepareSegmentsVbo(*gpsData, *magicBox))
+    {
+        return;
+    }
 #endif
-                }
-            }
-            else
-            {
-                pointEnd = static_cast<int>(segment.size()) - 1;
-            }
+    m_isTrailDrawn = true;
+}
 
-            for (int j = startPoint; j <= pointEnd; ++j)
-            {
-                const UtmPoint& utm = segment[j];
-                bool isInBox = true;
+// -----------------------------------------------------------------------------
 
-                if (m_settings.isBoundingBoxCropMode() &&
-                    !m_settings.isMultiMode())
-                {
-                    isInBox = magicBox->isInBox(utm);
-                }
+void Walk::drawTrail()
+{
+    const GpsDataPtr gpsData = m_gpsData.lock();
+    const MagicBoxPtr magicBox = m_magicBox.lock();
+    if (!m_isTrailDrawn || !gpsData || !magicBox)
+    {
+        return;
+    }
 
-                if (m_settings.useSpeed())
-                {
 #ifdef USE_OPENGL_FIXED_FUNCTIONS
-                    drawSpeedColor(utm.speed, isInBox);
+    drawSegmentsImmediate(*gpsData, *magicBox, m_drawStartSeg, m_drawStartPoint);
 #else
-                    drawSpeedColor(utm.speed, isInBox, currentColor);
+    drawSegmentsVbo(*gpsData, *magicBox);
 #endif
-                }
+}
 
-                if (isInBox)
-                {
-                    const ofxPoint<double>& pt = magicBox->getDrawablePoint(utm);
-#ifdef USE_OPENGL_FIXED_FUNCTIONS
-                    glVertex2d(getScaledUtmX(pt.x), getScaledUtmY(pt.y));
-#else
-                    pts.add(getScaledVec2f(pt.x, pt.y), currentColor);
-#endif
-                }
-                else
-                {
-#ifdef USE_OPENGL_FIXED_FUNCTIONS
-                    glEnd();
-                    glBegin(GL_LINE_STRIP);
-#else
-                    if (!pts.points.empty())
-                    {
-                        drawPoints(pts);
-                        pts = PointsAndColors();
-                    }
-#endif
-                }
-            }
-#ifdef USE_OPENGL_FIXED_FUNCTIONS
-            glEnd();
-#else
-            drawPoints(pts);
-#endif
-            startPoint = 0;
-        }
+// -----------------------------------------------------------------------------
 
-        drawCurrentPoint(*magicBox, currentUtm);
+void Walk::drawOverlay()
+{
+    const GpsDataPtr gpsData = m_gpsData.lock();
+    const MagicBoxPtr magicBox = m_magicBox.lock();
+    if (m_isTrailDrawn && gpsData && magicBox)
+    {
+        drawCurrentPoint(*magicBox,
+                         gpsData->getUtm(m_currentGpsSegment, m_currentGpsPoint),
+                         gpsData->getSpeed(m_currentGpsSegment, m_currentGpsPoint));
     }
 
     // draw borders of bounding boxes.
@@ -334,52 +484,57 @@ void Walk::drawAll()
 
     ofSetColor(m_fgColor);
 
-    BOOST_FOREACH(const UtmSegment& utmSegment, gpsData->getUTMPoints())
-    {
 #ifdef USE_OPENGL_FIXED_FUNCTIONS
-        glBegin(GL_LINE_STRIP);
-#else
-        tPoints pts;
-#endif
-        BOOST_FOREACH(const UtmPoint& utmPoint, utmSegment)
+    const size_t level = getLodLevel(*magicBox);
+    for (size_t i = 0; i < gpsData->getNumSegments(); ++i)
+    {
+        if (level > 0)
         {
-            bool isInBox = true;
-            if (m_settings.isBoundingBoxCropMode() && !m_settings.isMultiMode())
-            {
-                isInBox = magicBox->isInBox(utmPoint);
-            }
-            if (isInBox)
-            {
-                const ofxPoint<double>& tmp =
-                        magicBox->getDrawablePoint(utmPoint);
-#ifdef USE_OPENGL_FIXED_FUNCTIONS
-                glVertex2d(getScaledUtmX(tmp.x), getScaledUtmY(tmp.y));
-#else
-                pts.push_back(getScaledVec2f(tmp.x, tmp.y));
-#endif
-            }
-            else
-            {
-#ifdef USE_OPENGL_FIXED_FUNCTIONS
-                glEnd();
-                glBegin(GL_LINE_STRIP);
-#else
-                if (!pts.empty())
-                {
-                    m_vbo.setVertexData(&pts[0], (int)pts.size(), GL_DYNAMIC_DRAW);
-                    m_vbo.draw(GL_LINE_STRIP, 0, (int)pts.size());
-                    pts.clear();
-                }
-#endif
-            }
+            drawLodImmediate(*gpsData, *magicBox, level, i);
         }
-#ifdef USE_OPENGL_FIXED_FUNCTIONS
-        glEnd();
+        else
+        {
+            drawPointsImmediate(*gpsData, *magicBox, static_cast<int>(i), 0,
+                                static_cast<int>(gpsData->getNumPoints(i)) - 1,
+                                false);
+        }
+    }
 #else
-        m_vbo.setVertexData(&pts[0], (int)pts.size(), GL_DYNAMIC_DRAW);
-        m_vbo.draw(GL_LINE_STRIP, 0, (int)pts.size());
-#endif
+    updateTrackVbo(*gpsData);
+    if (m_numTrackPoints == 0)
+    {
+        return;
     }
+
+    // Zoomed out, a simplified level looks the same with less points.
+    const size_t level = getLodLevel(*magicBox);
+    if (level > 0)
+    {
+        updateLodVbo(*gpsData, level);
+    }
+    ofVbo& trackVbo = getTrackVbo();
+    ofVbo& vbo = level > 0 ? m_lodVbos[level] : trackVbo;
+
+    // All points in the foreground color, without speed colors.
+    collectVisibleRanges(*gpsData, 0, m_numTrackSegments,
+                         getVisibleBounds(*magicBox), level);
+    if (m_visibleFirsts.empty())
+    {
+        return;
+    }
+
+    trackVbo.disableColors();
+    beginTrackTransform(*magicBox, false);
+    vbo.bind();
+    drawTrackRanges(*gpsData, *magicBox, level, &m_visibleFirsts[0],
+                    &m_visibleCounts[0], m_visibleFirsts.size());
+    vbo.unbind();
+    endTrackTransform();
+    if (m_settings.useSpeed())
+    {
+        trackVbo.enableColors();
+    }
+#endif
 }
 
 // -----------------------------------------------------------------------------
@@ -415,116 +570,1062 @@ void Walk::drawBoxes()
 
 // -----------------------------------------------------------------------------
 
-void Walk::drawPoints(const PointsAndColors& pts)
-{
-#ifndef USE_OPENGL_FIXED_FUNCTIONS
-    const tPoints& points = pts.points;
-    const tColorSlices& colors = pts.colors;
-    m_vbo.setVertexData(&points[0], (int)points.size(), GL_DYNAMIC_DRAW);
-    for (tColorSlices::const_iterator it = colors.begin(); it != colors.end(); ++it)
-    {
-        ofSetColor(it->color);
-        m_vbo.draw(GL_LINE_STRIP, it->start, it->total);
-    }
-#endif
-}
-
-// -----------------------------------------------------------------------------
-// Draw helpers
-// -----------------------------------------------------------------------------
-
-std::pair<int, int> Walk::calculateStartSegmentAndStartPoint(const GpsData& gpsData)
+#ifdef USE_OPENGL_FIXED_FUNCTIONS
+void Walk::drawSegmentsImmediate(const GpsData& gpsData,
+                                 const MagicBox& magicBox,
+                                 const int startSeg,
+                                 int startPoint)
 {
-    if (m_maxPointsToDraw > 0 && m_currentPoint - m_maxPointsToDraw >= 0)
+    for (int i = startSeg; i <= m_currentGpsSegment; ++i)
     {
-        const int startIndex = m_currentPoint - m_maxPointsToDraw;
-        const GpsDataIndex& gpsDataIndex = gpsData.getIndices()[startIndex];
-        return std::make_pair(gpsDataIndex.gpsSegment, gpsDataIndex.gpsPoint);
-    }
-
-    return std::make_pair(0, 0);
-}
-
-// -----------------------------------------------------------------------------
+        ofSetColor(m_fgColor);
 
-#ifdef USE_OPENGL_FIXED_FUNCTIONS
-void Walk::drawSpeedColor(const double speed, bool& isInBox)
-#else
-void Walk::drawSpeedColor(const double speed, bool& isInBox, ofColor& currentColor)
-#endif
-{
-    const ofColor& color = speed > m_settings.getSpeedThreshold() ?
-        m_settings.getSpeedColorAbove() :
-        m_settings.getSpeedColorUnder();
+        int pointEnd;
+        if (i == m_currentGpsSegment)
+        {
+            pointEnd = m_currentGpsPoint;
+            if (m_interactiveMode && m_drawTraced)
+            {
+                ofSetColor(m_currentSegColor);
+            }
+        }
+        else
+        {
+            pointEnd = static_cast<int>(gpsData.getNumPoints(i)) - 1;
+        }
 
-#ifdef USE_OPENGL_FIXED_FUNCTIONS
-    ofSetColor(color);
-#else
-    currentColor = color;
-#endif
-    if (color.a == 0.0)
-    {
-        isInBox = false;
+        drawPointsImmediate(gpsData, magicBox, i, startPoint, pointEnd,
+                            m_settings.useSpeed());
+        startPoint = 0;
     }
 }
 
 // -----------------------------------------------------------------------------
 
-void Walk::drawCurrentPoint(const MagicBox& box, const UtmPoint& currentUtm)
+void Walk::drawPointsImmediate(const GpsData& gpsData,
+                               const MagicBox& magicBox,
+                               const int segmentIndex,
+                               const int startPoint,
+                               const int endPoint,
+                               const bool useSpeed)
 {
-    const ofxPoint<double>& currentPoint = box.getDrawablePoint(currentUtm);
-
-    if (m_currentPointIsImage)
+    // The modes are fixed for the whole segment, pick the loop once.
+    const bool isCropped = m_settings.isBoundingBoxCropMode() &&
+                           !m_settings.isMultiMode();
+    if (isCropped)
     {
-        ofSetColor(255, 255, 255, m_imageAlpha);
-        m_image.draw(getScaledUtmX(currentPoint.x),
-                     getScaledUtmY(currentPoint.y));
+        if (useSpeed)
+        {
+            drawPointsKernel<true, true>(gpsData, magicBox, segmentIndex,
+                                         startPoint, endPoint);
+        }
+        else
+        {
+            drawPointsKernel<true, false>(gpsData, magicBox, segmentIndex,
+                                          startPoint, endPoint);
+        }
     }
-    else if (!m_interactiveMode)
+    else
     {
-        ofFill();
-        bool skipDrawing = false;
-        if (m_settings.useSpeed())
+        if (useSpeed)
         {
-            skipDrawing = currentUtm.speed > m_settings.getSpeedThreshold() ?
-                m_settings.getSpeedColorAbove().a == 0.0 :
-                m_settings.getSpeedColorUnder().a == 0.0;
+            drawPointsKernel<false, true>(gpsData, magicBox, segmentIndex,
+                                          startPoint, endPoint);
         }
-        if (!skipDrawing)
+        else
         {
-            ofSetColor(m_dotColor);
-            ofCircle(getScaledUtmX(currentPoint.x),
-                     getScaledUtmY(currentPoint.y),
-                     m_dotSize);
+            drawPointsKernel<false, false>(gpsData, magicBox, segmentIndex,
+                                           startPoint, endPoint);
         }
     }
 }
 
-// -----------------------------------------------------------------------------
-// Getters
 // -----------------------------------------------------------------------------
 
-const std::string Walk::getCurrentGpsLocation() const
+template <bool IsCropped, bool UseSpeed>
+void Walk::drawPointsKernel(const GpsData& gpsData,
+                            const MagicBox& magicBox,
+                            const int segmentIndex,
+                            const int startPoint,
+                            const int endPoint)
 {
-    if (const GpsDataPtr gpsData = m_gpsData.lock())
+    const UtmSegmentView segment = gpsData.getUtmSegment(segmentIndex);
+    const ArrayView<double> speeds = gpsData.getSpeedSegment(segmentIndex);
+    const ArrayView<UtmBounds> chunks = gpsData.getChunkBounds(segmentIndex);
+    const UtmBounds box = magicBox.getBounds();
+    const int chunkSize = static_cast<int>(GpsData::BOUNDS_CHUNK_SIZE);
+
+    ofxPoint<double> scale;
+    ofxPoint<double> offset;
+    getImmediateTransform(magicBox, scale, offset);
+
+    const double speedThreshold = m_settings.getSpeedThreshold();
+    const ofColor& colorAbove = m_settings.getSpeedColorAbove();
+    const ofColor& colorUnder = m_settings.getSpeedColorUnder();
+
+    // Segment and chunk bounds decide for many points at once, only points
+    // of chunks on the border of the box are tested.
+    const tBoundsState segmentState = IsCropped
+        ? getBoundsState(gpsData.getSegmentBounds(segmentIndex), box)
+        : BOUNDS_INSIDE;
+    if (segmentState == BOUNDS_OUTSIDE)
     {
-        return gpsData->getGpsLocation(m_currentGpsSegment, m_currentGpsPoint);
+        return;
     }
-    return std::string();
-}
-
-// -----------------------------------------------------------------------------
 
-int Walk::getCurrentSegmentNum() const
+    tBoundsState chunkState = segmentState;
+    glBegin(GL_LINE_STRIP);
+    for (int j = startPoint; j <= endPoint; ++j)
+    {
+        if (IsCropped && segmentState == BOUNDS_PARTIAL &&
+            (j == startPoint || j % chunkSize == 0))
+        {
+            chunkState = getBoundsState(chunks[j / chunkSize], box);
+            if (chunkState == BOUNDS_OUTSIDE)
+            {
+                glEnd();
+                glBegin(GL_LINE_STRIP);
+                // Continue with the first point of the next chunk.
+                j = (j / chunkSize + 1) * chunkSize - 1;
+                continue;
+            }
+        }
+
+        const UtmPoint& utm = segment[j];
+        bool isInBox = !IsCropped || chunkState == BOUNDS_INSIDE ||
+                       magicBox.isInBox(utm);
+
+        if (UseSpeed)
+        {
+            const ofColor& color = speeds[j] > speedThreshold
+                                   ? colorAbove : colorUnder;
+            ofSetColor(color);
+            if (color.a == 0.0)
+            {
+                isInBox = false;
+            }
+        }
+
+        if (isInBox)
+        {
+            glVertex2d(offset.x + utm.x * scale.x, offset.y + utm.y * scale.y);
+        }
+        else
+        {
+            glEnd();
+            glBegin(GL_LINE_STRIP);
+        }
+    }
+    glEnd();
+}
+
+// -----------------------------------------------------------------------------
+
+void Walk::getImmediateTransform(const MagicBox& magicBox,
+                                 ofxPoint<double>& scale,
+                                 ofxPoint<double>& offset) const
 {
-    if (const GpsDataPtr gpsData = m_gpsData.lock())
+    // getScaledUtmX/Y(getDrawablePoint(utm)) is affine in utm.
+    const ofxRectangle<double>& theBox = magicBox.getTheBox();
+    const double x0 = getScaledUtmX(0.0);
+    const double y0 = getScaledUtmY(0.0);
+    scale.x = (getScaledUtmX(1.0) - x0) / theBox.getWidth();
+    scale.y = (getScaledUtmY(1.0) - y0) / theBox.getHeight();
+    offset.x = x0 - theBox.getX() * scale.x;
+    offset.y = y0 - theBox.getY() * scale.y;
+}
+
+// -----------------------------------------------------------------------------
+
+void Walk::drawLodImmediate(const GpsData& gpsData,
+                            const MagicBox& magicBox,
+                            const size_t level,
+                            const size_t segmentIndex)
+{
+    // The crop mode is fixed for the whole segment, pick the loop once.
+    if (m_settings.isBoundingBoxCropMode() && !m_settings.isMultiMode())
+    {
+        if (gpsData.getSegmentBounds(segmentIndex).intersects(
+                magicBox.getBounds()))
+        {
+            drawLodKernel<true>(gpsData, magicBox, level, segmentIndex);
+        }
+    }
+    else
+    {
+        drawLodKernel<false>(gpsData, magicBox, level, segmentIndex);
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+template <bool IsCropped>
+void Walk::drawLodKernel(const GpsData& gpsData,
+                         const MagicBox& magicBox,
+                         const size_t level,
+                         const size_t segmentIndex)
+{
+    ofxPoint<double> scale;
+    ofxPoint<double> offset;
+    getImmediateTransform(magicBox, scale, offset);
+
+    const UtmSegmentView utmPoints = gpsData.getUtmPoints();
+    const ArrayView<unsigned int> indices = gpsData.getLodIndices(level);
+    const size_t end = gpsData.getLodSegmentOffset(level, segmentIndex + 1);
+    glBegin(GL_LINE_STRIP);
+    for (size_t j = gpsData.getLodSegmentOffset(level, segmentIndex); j < end; ++j)
+    {
+        const UtmPoint& utm = utmPoints[indices[j]];
+        if (!IsCropped || magicBox.isInBox(utm))
+        {
+            glVertex2d(offset.x + utm.x * scale.x, offset.y + utm.y * scale.y);
+        }
+        else
+        {
+            glEnd();
+            glBegin(GL_LINE_STRIP);
+        }
+    }
+    glEnd();
+}
+#else
+bool Walk::prepareSegmentsVbo(const GpsData& gpsData, const MagicBox& magicBox)
+{
+    updateTrackVbo(gpsData);
+    if (m_numTrackPoints == 0)
+    {
+        return false;
+    }
+
+    updateTrail(gpsData, m_drawStartSeg, m_drawStartPoint);
+    if (m_trailFirsts.empty())
+    {
+        return false;
+    }
+
+    // An unlimited trail only grows. Finished segments are drawn once into
+    // the trace FBO, only the current segment is drawn every frame. Not
+    // with an effect shader, it changes the track every frame.
+    m_isTraceUsed = m_maxPointsToDraw <= 0 && m_drawStartSeg == 0 &&
+                    !isProgramBound();
+    if (m_isTraceUsed)
+    {
+        updateTraceFbo(gpsData, magicBox);
+
+        // The FBO holds premultiplied colors.
+        glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        ofSetColor(255, 255, 255);
+        m_traceFbo.draw(0, 0);
+        ofEnableAlphaBlending();
+    }
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+
+void Walk::drawSegmentsVbo(const GpsData& gpsData, const MagicBox& magicBox)
+{
+    // Only index ranges are drawn, the points stay on the GPU. Ranges of
+    // points the track worker has not delivered yet are left out.
+    const GLsizei numTrailRanges = static_cast<GLsizei>(m_trailFirsts.size());
+    GLsizei numRanges = numTrailRanges;
+    while (numRanges > 0 &&
+           static_cast<size_t>(m_trailFirsts[numRanges - 1] +
+                               m_trailCounts[numRanges - 1]) > m_numTrackPoints)
+    {
+        --numRanges;
+    }
+    const bool isCurrentSegColored = m_interactiveMode && m_drawTraced &&
+                                     numRanges == numTrailRanges;
+    if (isCurrentSegColored)
+    {
+        --numRanges;
+    }
+    const GLsizei firstRange = m_isTraceUsed ? m_numTracedSegs : 0;
+
+    ofVbo& trackVbo = getTrackVbo();
+    beginTrackTransform(magicBox, m_settings.useSpeed());
+    trackVbo.bind();
+    ofSetColor(m_fgColor);
+    if (numRanges > firstRange)
+    {
+        drawTrackRanges(gpsData, magicBox, 0, &m_trailFirsts[firstRange],
+                        &m_trailCounts[firstRange], numRanges - firstRange);
+    }
+    if (isCurrentSegColored)
+    {
+        ofSetColor(m_currentSegColor);
+        drawTrackRanges(gpsData, magicBox, 0, &m_trailFirsts.back(),
+                        &m_trailCounts.back(), 1);
+    }
+    trackVbo.unbind();
+    endTrackTransform();
+}
+
+// -----------------------------------------------------------------------------
+
+void Walk::updateTrail(const GpsData& gpsData,
+                       const int startSeg,
+                       const int startPoint)
+{
+    const int endSeg =
+        m_trailStartSeg + static_cast<int>(m_trailFirsts.size()) - 1;
+    if (m_trailFirsts.empty() ||
+        startSeg < m_trailStartSeg || startSeg > endSeg ||
+        m_currentGpsSegment < endSeg)
+    {
+        // Walked back, seeked or first frame.
+        m_trailFirsts.clear();
+        m_trailCounts.clear();
+        m_trailStartSeg = startSeg;
+    }
+    else if (startSeg > m_trailStartSeg)
+    {
+        // Segments the tail has left.
+        const int numDropped = startSeg - m_trailStartSeg;
+        m_trailFirsts.erase(m_trailFirsts.begin(),
+                            m_trailFirsts.begin() + numDropped);
+        m_trailCounts.erase(m_trailCounts.begin(),
+                            m_trailCounts.begin() + numDropped);
+        m_trailStartSeg = startSeg;
+    }
+
+    // Segments the head has entered. The former head segment is complete now.
+    for (int i = m_trailStartSeg + static_cast<int>(m_trailFirsts.size());
+         i <= m_currentGpsSegment; ++i)
+    {
+        if (!m_trailFirsts.empty())
+        {
+            m_trailCounts.back() =
+                static_cast<GLsizei>(gpsData.getSegmentOffset(i - 1) +
+                                     gpsData.getNumPoints(i - 1) -
+                                     m_trailFirsts.back());
+        }
+        m_trailFirsts.push_back(static_cast<GLint>(gpsData.getSegmentOffset(i)));
+        m_trailCounts.push_back(static_cast<GLsizei>(gpsData.getNumPoints(i)));
+    }
+
+    // Tail and head move inside their segments every frame.
+    const size_t tailOffset = gpsData.getSegmentOffset(m_trailStartSeg);
+    m_trailFirsts.front() = static_cast<GLint>(tailOffset + startPoint);
+    m_trailCounts.front() =
+        static_cast<GLsizei>(tailOffset +
+                             gpsData.getNumPoints(m_trailStartSeg) -
+                             m_trailFirsts.front());
+    m_trailCounts.back() =
+        static_cast<GLsizei>(gpsData.getSegmentOffset(m_currentGpsSegment) +
+                             m_currentGpsPoint + 1 - m_trailFirsts.back());
+}
+
+// -----------------------------------------------------------------------------
+
+void Walk::updateTraceFbo(const GpsData& gpsData, const MagicBox& magicBox)
+{
+    if (!m_traceFbo.isAllocated() ||
+        m_traceFbo.getWidth() != ofGetWidth() ||
+        m_traceFbo.getHeight() != ofGetHeight())
+    {
+        m_traceFbo.allocate(ofGetWidth(), ofGetHeight(), GL_RGBA);
+        m_numTracedSegs = -1;
+    }
+
+    const ofxRectangle<double>& box = magicBox.getTheBox();
+    const bool isBoxChanged = box.getX() != m_traceBox.getX() ||
+                              box.getY() != m_traceBox.getY() ||
+                              box.getWidth() != m_traceBox.getWidth() ||
+                              box.getHeight() != m_traceBox.getHeight();
+    // Walked back or seeked, the FBO holds too many segments.
+    const bool isClear = m_numTracedSegs < 0 || isBoxChanged ||
+                         m_numTracedSegs > m_currentGpsSegment;
+    // Only segments the track VBO holds completely, the last uploaded one
+    // may still grow while streaming.
+    int tracedEnd = MIN(m_currentGpsSegment,
+                        static_cast<int>(gpsData.getNumSegments()));
+    while (tracedEnd > 0 &&
+           gpsData.getLodSegmentOffset(0, tracedEnd) > m_numTrackPoints)
+    {
+        --tracedEnd;
+    }
+    if (!isClear && m_numTracedSegs == tracedEnd)
+    {
+        return;
+    }
+
+    m_traceFbo.begin();
+    if (isClear)
+    {
+        ofClear(0, 0, 0, 0);
+        m_numTracedSegs = 0;
+        m_traceBox = box;
+    }
+    // After a move or zoom only the segments in view are drawn again.
+    collectVisibleRanges(gpsData, m_numTracedSegs, tracedEnd,
+                         getVisibleBounds(magicBox));
+    if (!m_visibleFirsts.empty())
+    {
+        // Premultiplied colors, the FBO can then be blended like the lines.
+        glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA,
+                            GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        ofVbo& trackVbo = getTrackVbo();
+        beginTrackTransform(magicBox, m_settings.useSpeed());
+        trackVbo.bind();
+        ofSetColor(m_fgColor);
+        drawTrackRanges(gpsData, magicBox, 0, &m_visibleFirsts[0],
+                        &m_visibleCounts[0], m_visibleFirsts.size());
+        trackVbo.unbind();
+        endTrackTransform();
+        ofEnableAlphaBlending();
+    }
+    m_numTracedSegs = tracedEnd;
+    m_traceFbo.end();
+}
+
+// -----------------------------------------------------------------------------
+
+void Walk::updateTrackVbo(const GpsData& gpsData)
+{
+    if (m_trackWorker)
+    {
+        if (!m_trackWorker->isDone())
+        {
+            // Draw the last upload until the worker is done.
+            return;
+        }
+        appendTrackVertices(m_trackWorker->getTrack());
+        m_trackWorker.reset();
+    }
+
+    const size_t numPoints = gpsData.getUtmPoints().size();
+    if (numPoints == m_numTrackPoints)
+    {
+        return;
+    }
+    if (numPoints < m_numTrackPoints)
+    {
+        // Other data, not appended.
+        clearTrackVbos();
+    }
+    if (numPoints == 0)
+    {
+        return;
+    }
+    if (m_numTrackPoints == 0)
+    {
+        // Floats relative to the center of the data keep the precision of
+        // the UTM doubles for everything but continent sized data. While
+        // streaming this is the center of the first chunks.
+        m_trackOrigin = UtmPoint(
+            (gpsData.getMinUtmX() + gpsData.getMaxUtmX()) * 0.5,
+            (gpsData.getMinUtmY() + gpsData.getMaxUtmY()) * 0.5);
+    }
+
+    // Few new points are built right away, they are not worth a frame of
+    // delay.
+    const size_t begin = m_numTrackPoints;
+    if (numPoints - begin < MIN_POINTS_FOR_TRACK_WORKER)
+    {
+        const UtmSegmentView utmPoints = gpsData.getUtmPoints();
+        const ArrayView<double> speeds = gpsData.getSpeeds();
+        TrackVertices track;
+        track.numSegments = gpsData.getNumSegments();
+        buildTrackVertices(
+            UtmSegmentView(&utmPoints[begin], numPoints - begin),
+            speeds.empty() ? ArrayView<double>()
+                           : ArrayView<double>(&speeds[begin], numPoints - begin),
+            m_trackOrigin, m_settings, track);
+        appendTrackVertices(track);
+        return;
+    }
+
+    if (!m_trackThreadPool)
+    {
+        m_trackThreadPool.reset(new Poco::ThreadPool(1, 1));
+    }
+    m_trackWorker.reset(new TrackWorker(gpsData, begin, m_trackOrigin,
+                                        m_settings));
+    m_trackThreadPool->start(*m_trackWorker);
+}
+
+// -----------------------------------------------------------------------------
+
+void Walk::buildTrackVertices(const UtmSegmentView& utmPoints,
+                              const ArrayView<double>& speeds,
+                              const UtmPoint& origin,
+                              const AppSettings& settings,
+                              TrackVertices& track)
+{
+    track.vertices.reserve(track.vertices.size() + utmPoints.size());
+    BOOST_FOREACH(const UtmPoint& utm, utmPoints)
+    {
+        track.vertices.push_back(
+            ofVec2f(static_cast<float>(utm.x - origin.x),
+                    static_cast<float>(utm.y - origin.y)));
+    }
+
+    if (settings.useSpeed())
+    {
+        // The track shader maps speeds to colors. The colors are only used
+        // with the effect shader of the app or without shaders.
+        const ofFloatColor above = settings.getSpeedColorAbove();
+        const ofFloatColor under = settings.getSpeedColorUnder();
+        track.speeds.reserve(track.speeds.size() + speeds.size());
+        track.colors.reserve(track.colors.size() + speeds.size());
+        BOOST_FOREACH(const double speed, speeds)
+        {
+            track.speeds.push_back(static_cast<float>(speed));
+            track.colors.push_back(speed > settings.getSpeedThreshold()
+                                   ? above : under);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+void Walk::appendTrackVertices(const TrackVertices& track)
+{
+    const size_t begin = m_trackVertices.vertices.size();
+    m_trackVertices.vertices.insert(m_trackVertices.vertices.end(),
+                                    track.vertices.begin(),
+                                    track.vertices.end());
+    m_trackVertices.speeds.insert(m_trackVertices.speeds.end(),
+                                  track.speeds.begin(), track.speeds.end());
+    m_trackVertices.colors.insert(m_trackVertices.colors.end(),
+                                  track.colors.begin(), track.colors.end());
+    const size_t end = m_trackVertices.vertices.size();
+    const bool useSpeed = !m_trackVertices.speeds.empty();
+
+    if (end > m_trackCapacity)
+    {
+        // Doubling keeps the points sent again in O(n) over a whole stream.
+        // The new buffer is the back one, the GPU may still draw from the
+        // front one.
+        m_trackCapacity = MAX(end, 2 * m_trackCapacity);
+        const int capacity = static_cast<int>(m_trackCapacity);
+        ofVbo& vbo = m_trackVbos[1 - m_frontTrackVbo];
+        vbo.setVertexData(static_cast<const float*>(0), 2, capacity,
+                          GL_DYNAMIC_DRAW, sizeof(ofVec2f));
+        if (useSpeed)
+        {
+            vbo.setAttributeData(TRACK_SPEED_ATTRIBUTE,
+                                 static_cast<const float*>(0), 1, capacity,
+                                 GL_DYNAMIC_DRAW, sizeof(float));
+            vbo.setColorData(static_cast<const float*>(0), capacity,
+                             GL_DYNAMIC_DRAW, sizeof(ofFloatColor));
+        }
+        uploadTrackRange(vbo, 0, end);
+        m_trackVbos[m_frontTrackVbo].clear();
+        m_frontTrackVbo = 1 - m_frontTrackVbo;
+    }
+    else
+    {
+        uploadTrackRange(getTrackVbo(), begin, end);
+    }
+
+    m_numTrackPoints = end;
+    m_numTrackSegments = track.numSegments;
+}
+
+// -----------------------------------------------------------------------------
+
+void Walk::uploadTrackRange(ofVbo& vbo, const size_t begin, const size_t end)
+{
+    if (begin == end)
+    {
+        return;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, vbo.getVertId());
+    glBufferSubData(GL_ARRAY_BUFFER, begin * sizeof(ofVec2f),
+                    (end - begin) * sizeof(ofVec2f),
+                    &m_trackVertices.vertices[begin]);
+    if (!m_trackVertices.speeds.empty())
+    {
+        glBindBuffer(GL_ARRAY_BUFFER,
+                     vbo.getAttributeId(TRACK_SPEED_ATTRIBUTE));
+        glBufferSubData(GL_ARRAY_BUFFER, begin * sizeof(float),
+                        (end - begin) * sizeof(float),
+                        &m_trackVertices.speeds[begin]);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo.getColorId());
+        glBufferSubData(GL_ARRAY_BUFFER, begin * sizeof(ofFloatColor),
+                        (end - begin) * sizeof(ofFloatColor),
+                        &m_trackVertices.colors[begin]);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// -----------------------------------------------------------------------------
+
+void Walk::clearTrackVbos()
+{
+    m_trackVbos[0].clear();
+    m_trackVbos[1].clear();
+    m_trackCapacity = 0;
+    m_trackVertices = TrackVertices();
+    m_numTrackPoints = 0;
+    m_numTrackSegments = 0;
+    // The origin is set again with the next points.
+    m_numLodPoints.assign(GpsData::NUM_LOD_LEVELS, 0);
+}
+
+// -----------------------------------------------------------------------------
+
+void Walk::waitForTrackWorker()
+{
+    if (m_trackThreadPool)
+    {
+        m_trackThreadPool->joinAll();
+    }
+    m_trackWorker.reset();
+}
+
+// -----------------------------------------------------------------------------
+
+void Walk::updateLodVbo(const GpsData& gpsData, const size_t level)
+{
+    const ArrayView<unsigned int> indices = gpsData.getLodIndices(level);
+    if (indices.size() == m_numLodPoints[level])
+    {
+        return;
+    }
+
+    const UtmSegmentView utmPoints = gpsData.getUtmPoints();
+    std::vector<ofVec2f> vertices;
+    vertices.reserve(indices.size());
+    BOOST_FOREACH(const unsigned int index, indices)
+    {
+        const UtmPoint& utm = utmPoints[index];
+        vertices.push_back(ofVec2f(static_cast<float>(utm.x - m_trackOrigin.x),
+                                   static_cast<float>(utm.y - m_trackOrigin.y)));
+    }
+    if (vertices.empty())
+    {
+        m_lodVbos[level].clear();
+    }
+    else
+    {
+        m_lodVbos[level].setVertexData(&vertices[0],
+                                       static_cast<int>(vertices.size()),
+                                       GL_STATIC_DRAW);
+    }
+    m_numLodPoints[level] = indices.size();
+}
+
+// -----------------------------------------------------------------------------
+
+UtmBounds Walk::getVisibleBounds(const MagicBox& magicBox) const
+{
+    if (m_settings.isBoundingBoxCropMode() && !m_settings.isMultiMode())
+    {
+        return magicBox.getBounds();
+    }
+
+    // The window mapped back to UTM, see beginTrackTransform().
+    const ofxRectangle<double>& box = magicBox.getTheBox();
+    const double x0 = getScaledUtmX(0.0);
+    const double y0 = getScaledUtmY(0.0);
+    const double scaleX = box.getWidth() / (getScaledUtmX(1.0) - x0);
+    const double scaleY = box.getHeight() / (getScaledUtmY(1.0) - y0);
+    UtmBounds bounds;
+    bounds.add(UtmPoint(box.getX() - x0 * scaleX,
+                        box.getY() - y0 * scaleY));
+    bounds.add(UtmPoint(box.getX() + (ofGetWidth() - x0) * scaleX,
+                        box.getY() + (ofGetHeight() - y0) * scaleY));
+    return bounds;
+}
+
+// -----------------------------------------------------------------------------
+
+void Walk::collectVisibleRanges(const GpsData& gpsData,
+                                const size_t segmentBegin,
+                                const size_t segmentEnd,
+                                const UtmBounds& visible,
+                                const size_t level)
+{
+    m_visibleFirsts.clear();
+    m_visibleCounts.clear();
+
+    // Offsets come from the GpsData, which may hold more points than were
+    // uploaded while streaming.
+    const size_t numUploaded =
+        level > 0 ? m_numLodPoints[level] : m_numTrackPoints;
+    const size_t chunkSize = GpsData::BOUNDS_CHUNK_SIZE;
+    for (size_t i = segmentBegin; i < segmentEnd; ++i)
+    {
+        const size_t offset = gpsData.getLodSegmentOffset(level, i);
+        if (offset >= numUploaded)
+        {
+            break;
+        }
+        const size_t numPoints =
+            MIN(gpsData.getLodSegmentOffset(level, i + 1), numUploaded) - offset;
+        const tBoundsState segmentState =
+            getBoundsState(gpsData.getSegmentBounds(i), visible);
+        if (segmentState == BOUNDS_OUTSIDE)
+        {
+            continue;
+        }
+        // Chunks are only known for all points.
+        if (segmentState == BOUNDS_INSIDE || level > 0)
+        {
+            m_visibleFirsts.push_back(static_cast<GLint>(offset));
+            m_visibleCounts.push_back(static_cast<GLsizei>(numPoints));
+            continue;
+        }
+
+        // Runs of visible chunks, with the last point before and the first
+        // point after the run.
+        const ArrayView<UtmBounds> chunks = gpsData.getChunkBounds(i);
+        size_t runBegin = 0;
+        bool isInRun = false;
+        for (size_t k = 0; k <= chunks.size(); ++k)
+        {
+            const bool isVisible = k < chunks.size() &&
+                getBoundsState(chunks[k], visible) != BOUNDS_OUTSIDE;
+            if (isVisible && !isInRun)
+            {
+                runBegin = k * chunkSize;
+                isInRun = true;
+            }
+            else if (!isVisible && isInRun)
+            {
+                const size_t first = runBegin > 0 ? runBegin - 1 : 0;
+                const size_t end = MIN(k * chunkSize + 1, numPoints);
+                if (first < end)
+                {
+                    m_visibleFirsts.push_back(static_cast<GLint>(offset + first));
+                    m_visibleCounts.push_back(static_cast<GLsizei>(end - first));
+                }
+                isInRun = false;
+            }
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+void Walk::drawTrackRanges(const GpsData& gpsData,
+                           const MagicBox& magicBox,
+                           const size_t level,
+                           const GLint* firsts,
+                           const GLsizei* counts,
+                           size_t numRanges)
+{
+    if (m_settings.isBoundingBoxCropMode() && !m_settings.isMultiMode())
+    {
+        cropRanges(gpsData, magicBox, level, firsts, counts, numRanges);
+        if (m_cropFirsts.empty())
+        {
+            return;
+        }
+        firsts = &m_cropFirsts[0];
+        counts = &m_cropCounts[0];
+        numRanges = m_cropFirsts.size();
+    }
+    glMultiDrawArrays(GL_LINE_STRIP, firsts, counts,
+                      static_cast<GLsizei>(numRanges));
+}
+
+// -----------------------------------------------------------------------------
+
+void Walk::cropRanges(const GpsData& gpsData,
+                      const MagicBox& magicBox,
+                      const size_t level,
+                      const GLint* firsts,
+                      const GLsizei* counts,
+                      const size_t numRanges)
+{
+    m_cropFirsts.clear();
+    m_cropCounts.clear();
+
+    const UtmSegmentView utmPoints = gpsData.getUtmPoints();
+    const ArrayView<unsigned int> lodIndices = gpsData.getLodIndices(level);
+    const UtmBounds box = magicBox.getBounds();
+    const size_t chunkSize = GpsData::BOUNDS_CHUNK_SIZE;
+
+    for (size_t r = 0; r < numRanges; ++r)
+    {
+        const size_t first = static_cast<size_t>(firsts[r]);
+        const size_t end = first + static_cast<size_t>(counts[r]);
+
+        // Ranges stay inside of one segment. Chunks are only known for
+        // all points, simplified points are tested one by one.
+        size_t segmentIndex = 0;
+        size_t pointIndex = 0;
+        ArrayView<UtmBounds> chunks;
+        if (level == 0 &&
+            gpsData.getSegmentAndPoint(first, segmentIndex, pointIndex))
+        {
+            chunks = gpsData.getChunkBounds(segmentIndex);
+        }
+        const size_t segmentOffset = first - pointIndex;
+
+        size_t runBegin = first;
+        size_t j = first;
+        while (j < end)
+        {
+            tBoundsState chunkState = BOUNDS_PARTIAL;
+            size_t chunkEnd = j + 1;
+            if (!chunks.empty())
+            {
+                const size_t chunk = (j - segmentOffset) / chunkSize;
+                chunkState = getBoundsState(chunks[chunk], box);
+                chunkEnd = MIN(segmentOffset + (chunk + 1) * chunkSize, end);
+            }
+            if (chunkState == BOUNDS_PARTIAL)
+            {
+                for (; j < chunkEnd; ++j)
+                {
+                    const UtmPoint& utm =
+                        utmPoints[level > 0 ? lodIndices[j] : j];
+                    if (!magicBox.isInBox(utm))
+                    {
+                        if (j - runBegin > 1)
+                        {
+                            m_cropFirsts.push_back(static_cast<GLint>(runBegin));
+                            m_cropCounts.push_back(static_cast<GLsizei>(j - runBegin));
+                        }
+                        runBegin = j + 1;
+                    }
+                }
+            }
+            else if (chunkState == BOUNDS_OUTSIDE)
+            {
+                if (j - runBegin > 1)
+                {
+                    m_cropFirsts.push_back(static_cast<GLint>(runBegin));
+                    m_cropCounts.push_back(static_cast<GLsizei>(j - runBegin));
+                }
+                runBegin = chunkEnd;
+            }
+            j = chunkEnd;
+        }
+        if (end - runBegin > 1)
+        {
+            m_cropFirsts.push_back(static_cast<GLint>(runBegin));
+            m_cropCounts.push_back(static_cast<GLsizei>(end - runBegin));
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+void Walk::beginTrackTransform(const MagicBox& magicBox,
+                               const bool isSpeedColored)
+{
+    // getScaledUtmX/Y(getDrawablePoint(utm)) is affine in utm, the box and
+    // the view only change the parameters of the transform.
+    const ofxRectangle<double>& box = magicBox.getTheBox();
+    const double x0 = getScaledUtmX(0.0);
+    const double y0 = getScaledUtmY(0.0);
+    const double x1 = getScaledUtmX(1.0);
+    const double y1 = getScaledUtmY(1.0);
+
+    // An effect shader set by the app replaces the track shader, it gets
+    // the transform through the modelview matrix instead.
+    m_isTrackShaderActive = m_isTrailBatchActive ||
+                            (!isProgramBound() && loadTrackShader());
+
+    if (m_isTrackShaderActive)
+    {
+        if (!m_isTrailBatchActive)
+        {
+            m_trackShader.begin();
+        }
+        m_trackShader.setUniform2f("trackOrigin",
+                                   static_cast<float>(m_trackOrigin.x - box.getX()),
+                                   static_cast<float>(m_trackOrigin.y - box.getY()));
+        m_trackShader.setUniform2f("boxSize",
+                                   static_cast<float>(box.getWidth()),
+                                   static_cast<float>(box.getHeight()));
+        m_trackShader.setUniform2f("viewOffset",
+                                   static_cast<float>(x0),
+                                   static_cast<float>(y0));
+        m_trackShader.setUniform2f("viewScale",
+                                   static_cast<float>(x1 - x0),
+                                   static_cast<float>(y1 - y0));
+
+        m_trackShader.setUniform1i("useSpeed", isSpeedColored ? 1 : 0);
+        if (isSpeedColored)
+        {
+            const ofFloatColor above = m_settings.getSpeedColorAbove();
+            const ofFloatColor under = m_settings.getSpeedColorUnder();
+            m_trackShader.setUniform1f("speedThreshold",
+                                       static_cast<float>(m_settings.getSpeedThreshold()));
+            m_trackShader.setUniform4f("speedColorAbove",
+                                       above.r, above.g, above.b, above.a);
+            m_trackShader.setUniform4f("speedColorUnder",
+                                       under.r, under.g, under.b, under.a);
+        }
+    }
+    else
+    {
+        ofPushMatrix();
+        ofTranslate(x0, y0);
+        ofScale((x1 - x0) / box.getWidth(), (y1 - y0) / box.getHeight());
+        ofTranslate(m_trackOrigin.x - box.getX(), m_trackOrigin.y - box.getY());
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+void Walk::endTrackTransform()
+{
+    if (m_isTrackShaderActive)
+    {
+        if (!m_isTrailBatchActive)
+        {
+            m_trackShader.end();
+        }
+        m_isTrackShaderActive = false;
+    }
+    else
+    {
+        ofPopMatrix();
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+bool Walk::loadTrackShader()
+{
+    // Set up once, on first use with a GL context.
+    if (!m_isTrackShaderSetup)
+    {
+        m_isTrackShaderSetup = true;
+        m_isTrackShaderLoaded =
+            m_trackShader.setupShaderFromSource(GL_VERTEX_SHADER,
+                                                trackVertexShader) &&
+            m_trackShader.setupShaderFromSource(GL_FRAGMENT_SHADER,
+                                                trackFragmentShader);
+        if (m_isTrackShaderLoaded)
+        {
+            m_trackShader.bindAttribute(TRACK_SPEED_ATTRIBUTE, "speed");
+            m_isTrackShaderLoaded = m_trackShader.linkProgram();
+        }
+        if (!m_isTrackShaderLoaded)
+        {
+            ofLogWarning(Logger::WALK,
+                         "Track shader not available, using the modelview matrix.");
+        }
+    }
+    return m_isTrackShaderLoaded;
+}
+#endif
+
+// -----------------------------------------------------------------------------
+
+void Walk::beginTrailBatch()
+{
+#ifndef USE_OPENGL_FIXED_FUNCTIONS
+    if (!m_isTrailBatchActive && !isProgramBound() && loadTrackShader())
+    {
+        m_trackShader.begin();
+        m_isTrailBatchActive = true;
+    }
+#endif
+}
+
+// -----------------------------------------------------------------------------
+
+void Walk::endTrailBatch()
+{
+#ifndef USE_OPENGL_FIXED_FUNCTIONS
+    if (m_isTrailBatchActive)
+    {
+        m_trackShader.end();
+        m_isTrailBatchActive = false;
+    }
+#endif
+}
+
+// -----------------------------------------------------------------------------
+// Draw helpers
+// -----------------------------------------------------------------------------
+
+size_t Walk::getLodLevel(const MagicBox& magicBox) const
+{
+    // UTM units per pixel, lines closer than half of it fall on the same
+    // pixels.
+    const double pixelSize = magicBox.getTheBox().getWidth() /
+        std::fabs(getScaledUtmX(1.0) - getScaledUtmX(0.0));
+    size_t level = 0;
+    while (level + 1 < GpsData::NUM_LOD_LEVELS &&
+           GpsData::getLodTolerance(level + 1) <= 0.5 * pixelSize)
+    {
+        ++level;
+    }
+    return level;
+}
+
+std::pair<int, int> Walk::calculateStartSegmentAndStartPoint(const GpsData& gpsData)
+{
+    if (m_maxPointsToDraw > 0 && m_currentPoint - m_maxPointsToDraw >= 0)
+    {
+        const size_t startIndex = m_currentPoint - m_maxPointsToDraw;
+        size_t segment, point;
+        if (gpsData.getSegmentAndPoint(startIndex, segment, point))
+        {
+            return std::make_pair(static_cast<int>(segment),
+                                  static_cast<int>(point));
+        }
+    }
+
+    return std::make_pair(0, 0);
+}
+
+// -----------------------------------------------------------------------------
+
+void Walk::drawCurrentPoint(const MagicBox& box,
+                            const UtmPoint& currentUtm,
+                            const double currentSpeed)
+{
+    const ofxPoint<double>& currentPoint = box.getDrawablePoint(currentUtm);
+
+    if (m_currentPointIsImage)
+    {
+        ofSetColor(255, 255, 255, m_imageAlpha);
+        m_image.draw(getScaledUtmX(currentPoint.x),
+                     getScaledUtmY(currentPoint.y));
+    }
+    else if (!m_interactiveMode)
     {
-        try
+        ofFill();
+        bool skipDrawing = false;
+        if (m_settings.useSpeed())
         {
-            const GpsSegmentVector& segments = gpsData->getSegments();
-            return segments.at(m_currentGpsSegment).getSegmentNum();
+            skipDrawing = currentSpeed > m_settings.getSpeedThreshold() ?
+                m_settings.getSpeedColorAbove().a == 0.0 :
+                m_settings.getSpeedColorUnder().a == 0.0;
+        }
+        if (!skipDrawing)
+        {
+            ofSetColor(m_dotColor);
+            ofCircle(getScaledUtmX(currentPoint.x),
+                     getScaledUtmY(currentPoint.y),
+                     m_dotSize);
         }
-        catch (const std::out_of_range&) {}
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Getters
+// -----------------------------------------------------------------------------
+
+const std::string Walk::getCurrentGpsLocation() const
+{
+    if (const GpsDataPtr gpsData = m_gpsData.lock())
+    {
+        return gpsData->getGpsLocation(m_currentGpsSegment, m_currentGpsPoint);
+    }
+    return std::string();
+}
+
+// -----------------------------------------------------------------------------
+
+int Walk::getCurrentSegmentNum() const
+{
+    if (const GpsDataPtr gpsData = m_gpsData.lock())
+    {
+        return gpsData->getSegmentNum(m_currentGpsSegment);
     }
     return 0;
 }
@@ -538,18 +1639,22 @@ int Walk::getCurrentPointNum() const
 
 // -----------------------------------------------------------------------------
 
+tEpoch Walk::getCurrentTime() const
+{
+    if (const GpsDataPtr gpsData = m_gpsData.lock())
+    {
+        return gpsData->getTime(m_currentGpsSegment, m_currentGpsPoint);
+    }
+    return 0;
+}
+
+// -----------------------------------------------------------------------------
+
 std::string Walk::getCurrentTimestamp() const
 {
     if (const GpsDataPtr gpsData = m_gpsData.lock())
     {
-        try
-        {
-            const GpsSegmentVector& segments = gpsData->getSegments();
-            const GpsPointVector& points =
-                    segments.at(m_currentGpsSegment).getPoints();
-            return points.at(m_currentGpsPoint).getTimestamp();
-        }
-        catch (const std::out_of_range&) {}
+        return gpsData->getTimestamp(m_currentGpsSegment, m_currentGpsPoint);
     }
     return std::string();
 }
@@ -607,6 +1712,14 @@ double Walk::getCurrentUtmY() const
 void Walk::setGpsData(const GpsDataWeak gpsDataWeak)
 {
     m_gpsData = gpsDataWeak;
+#ifndef USE_OPENGL_FIXED_FUNCTIONS
+    // Upload the new data on the next draw.
+    waitForTrackWorker();
+    clearTrackVbos();
+    m_trailFirsts.clear();
+    m_trailCounts.clear();
+    m_numTracedSegs = -1;
+#endif
 }
 
 // -----------------------------------------------------------------------------
@@ -6,6 +6,8 @@
 #define _WALK_H_
 
 #include <string>
+#include "Poco/Event.h"
+#include "Poco/ThreadPool.h"
 #include "GpsData.h"
 #include "MagicBox.h"
 #include "DrawingLifeDrawable.h"
@@ -29,12 +31,35 @@ public:
 
     void reset();
 
+    /**
+    * \brief Set the walk to the state after numPoints calls of update().
+    *
+    * Sets the segment and point directly without stepping.
+    * \param numPoints number of points walked.
+    */
+    void seek(size_t numPoints);
+
     void draw();
     void drawAll();
 
+    /**
+    * \brief Draw in passes, so the trails of all walks can be batched.
+    *
+    * draw() is prepareDraw(), drawTrail() and drawOverlay(). Calling each
+    * pass for all walks, with drawTrail() between beginTrailBatch() and
+    * endTrailBatch(), binds the track shader once for all walks.
+    */
+    void prepareDraw();
+    void drawTrail();
+    void drawOverlay();
+
+    static void beginTrailBatch();
+    static void endTrailBatch();
+
     const std::string getCurrentGpsLocation() const;
     int getCurrentSegmentNum() const;
     int getCurrentPointNum() const;
+    tEpoch getCurrentTime() const;
     std::string getCurrentTimestamp() const;
     double getCurrentLongitude() const;
     double getCurrentLatitude() const;
@@ -54,21 +79,178 @@ public:
 
 private:
 
-    void drawPoints(const PointsAndColors& pts);
-
     void updateToSegment(const tWalkDirection direction);
 
     void drawBoxes();
 
     std::pair<int, int> calculateStartSegmentAndStartPoint(const GpsData& gpsData);
 
+    /**
+    * \brief Get the coarsest simplification level that is still exact to
+    * half a pixel with the current box.
+    */
+    size_t getLodLevel(const MagicBox& magicBox) const;
+
 #ifdef USE_OPENGL_FIXED_FUNCTIONS
-    void drawSpeedColor(double speed, bool& isInBox);
+    void drawSegmentsImmediate(const GpsData& gpsData,
+                               const MagicBox& magicBox,
+                               int startSeg,
+                               int startPoint);
+    /**
+    * \brief Draw points startPoint to endPoint of a segment, cropped to the box.
+    */
+    void drawPointsImmediate(const GpsData& gpsData,
+                             const MagicBox& magicBox,
+                             int segmentIndex,
+                             int startPoint,
+                             int endPoint,
+                             bool useSpeed);
+    /**
+    * \brief Point loop of drawPointsImmediate() for one mode combination.
+    */
+    template <bool IsCropped, bool UseSpeed>
+    void drawPointsKernel(const GpsData& gpsData,
+                          const MagicBox& magicBox,
+                          int segmentIndex,
+                          int startPoint,
+                          int endPoint);
+    /**
+    * \brief Scale and offset from UTM to window coordinates, for the point
+    * loops.
+    */
+    void getImmediateTransform(const MagicBox& magicBox,
+                               ofxPoint<double>& scale,
+                               ofxPoint<double>& offset) const;
+    void drawLodImmediate(const GpsData& gpsData,
+                          const MagicBox& magicBox,
+                          size_t level,
+                          size_t segmentIndex);
+    /**
+    * \brief Point loop of drawLodImmediate() for one crop mode.
+    */
+    template <bool IsCropped>
+    void drawLodKernel(const GpsData& gpsData,
+                       const MagicBox& magicBox,
+                       size_t level,
+                       size_t segmentIndex);
 #else
-    void drawSpeedColor(double speed, bool& isInBox, ofColor& currentColor);
+    /**
+    * \brief Update the track VBO and trail and draw the trace FBO.
+    * \return false if there is nothing to draw.
+    */
+    bool prepareSegmentsVbo(const GpsData& gpsData, const MagicBox& magicBox);
+    /**
+    * \brief Draw the trail ranges from the track VBO.
+    */
+    void drawSegmentsVbo(const GpsData& gpsData, const MagicBox& magicBox);
+    /// Arrays of the track VBO, relative to m_trackOrigin.
+    struct TrackVertices
+    {
+        TrackVertices() : numSegments(0) {}
+        std::vector<ofVec2f> vertices;
+        std::vector<float> speeds;
+        std::vector<ofFloatColor> colors;
+        size_t numSegments;
+    };
+    class TrackWorker;
+
+    /**
+    * \brief Append the points gpsData got since the last upload.
+    *
+    * Many new points are built by a TrackWorker while the last upload is
+    * drawn.
+    */
+    void updateTrackVbo(const GpsData& gpsData);
+    /**
+    * \brief Append vertices, speeds and colors of utmPoints to track.
+    */
+    static void buildTrackVertices(const UtmSegmentView& utmPoints,
+                                   const ArrayView<double>& speeds,
+                                   const UtmPoint& origin,
+                                   const AppSettings& settings,
+                                   TrackVertices& track);
+    /**
+    * \brief Append track behind the uploaded points.
+    *
+    * Only the new points are sent. A full buffer is replaced by one of
+    * twice the size in the back VBO.
+    */
+    void appendTrackVertices(const TrackVertices& track);
+    void uploadTrackRange(ofVbo& vbo, size_t begin, size_t end);
+    void clearTrackVbos();
+    void waitForTrackWorker();
+    ofVbo& getTrackVbo() { return m_trackVbos[m_frontTrackVbo]; }
+    /**
+    * \brief Move the ends of the trail ranges to the current walk state.
+    *
+    * Only segments entered or left since the last frame are touched.
+    */
+    void updateTrail(const GpsData& gpsData, int startSeg, int startPoint);
+    /**
+    * \brief Rasterize the segments finished since the last frame.
+    *
+    * Cleared and drawn again when the MagicBox or the window changes.
+    */
+    void updateTraceFbo(const GpsData& gpsData, const MagicBox& magicBox);
+    /**
+    * \brief Draw ranges of the bound VBO as line strips.
+    *
+    * In crop mode the ranges are split at points outside the MagicBox
+    * first, lines to those points are not drawn.
+    * \param level simplification level the ranges index into.
+    */
+    void drawTrackRanges(const GpsData& gpsData,
+                         const MagicBox& magicBox,
+                         size_t level,
+                         const GLint* firsts,
+                         const GLsizei* counts,
+                         size_t numRanges);
+    /**
+    * \brief Split ranges into the runs of points inside the MagicBox.
+    *
+    * Chunk bounds decide for most points, only points of chunks on the
+    * border of the box are tested. Result in m_cropFirsts/m_cropCounts.
+    */
+    void cropRanges(const GpsData& gpsData,
+                    const MagicBox& magicBox,
+                    size_t level,
+                    const GLint* firsts,
+                    const GLsizei* counts,
+                    size_t numRanges);
+    /**
+    * \brief Get the part of the UTM plane that can be seen, the MagicBox in
+    * crop mode, else the window.
+    */
+    UtmBounds getVisibleBounds(const MagicBox& magicBox) const;
+    /**
+    * \brief Collect VBO ranges of the segments that intersect visible.
+    *
+    * Segments and chunks outside are left out, ranges overlap one point
+    * into culled chunks so lines leaving the visible part stay.
+    * \param level simplification level, 0 for the track VBO.
+    */
+    void collectVisibleRanges(const GpsData& gpsData,
+                              size_t segmentBegin,
+                              size_t segmentEnd,
+                              const UtmBounds& visible,
+                              size_t level = 0);
+    /**
+    * \brief Upload the points of a simplification level.
+    */
+    void updateLodVbo(const GpsData& gpsData, size_t level);
+    /**
+    * \brief Set up the transform from track VBO coordinates to the screen.
+    * \param isSpeedColored color the points by their speed.
+    */
+    void beginTrackTransform(const MagicBox& magicBox, bool isSpeedColored);
+    void endTrackTransform();
+
+    static bool loadTrackShader();
 #endif
 
-    void drawCurrentPoint(const MagicBox& box, const UtmPoint& currentUtm);
+    void drawCurrentPoint(const MagicBox& box,
+                          const UtmPoint& currentUtm,
+                          double currentSpeed);
 
     typedef boost::function<double(const GpsData&,int,int)> tFnGetCurrentDouble;
     double getCurrentDoubleValue(const tFnGetCurrentDouble& fnGetCurrentDouble) const;
@@ -109,8 +291,53 @@ private:
 
 	int m_imageAlpha;
 
+    /// Set by prepareDraw() for the other passes.
+    bool m_isTrailDrawn;
+    int m_drawStartSeg;
+    int m_drawStartPoint;
+
 #ifndef USE_OPENGL_FIXED_FUNCTIONS
-    ofVbo m_vbo;
+    /// All points of the walk relative to m_trackOrigin. The front one is
+    /// drawn, the other one takes the points when the front one is full.
+    ofVbo m_trackVbos[2];
+    size_t m_frontTrackVbo;
+    /// Points the track VBOs have room for.
+    size_t m_trackCapacity;
+    size_t m_numTrackPoints;
+    size_t m_numTrackSegments;
+    /// Uploaded arrays, sent again when the buffer grows.
+    TrackVertices m_trackVertices;
+    boost::scoped_ptr<TrackWorker> m_trackWorker;
+    boost::scoped_ptr<Poco::ThreadPool> m_trackThreadPool;
+    /// Center of the data at the first upload, fixed until the data is
+    /// cleared.
+    UtmPoint m_trackOrigin;
+    /// First VBO index and count per segment of the drawn trail.
+    std::vector<GLint> m_trailFirsts;
+    std::vector<GLsizei> m_trailCounts;
+    int m_trailStartSeg;
+    /// Finished segments of an unlimited trail, in window coordinates.
+    ofFbo m_traceFbo;
+    /// Number of segments in m_traceFbo, -1 if it has to be cleared.
+    int m_numTracedSegs;
+    bool m_isTraceUsed;
+    ofxRectangle<double> m_traceBox;
+    /// Simplified points per level, level 0 is the track VBO.
+    std::vector<ofVbo> m_lodVbos;
+    std::vector<size_t> m_numLodPoints;
+    /// Ranges from collectVisibleRanges().
+    std::vector<GLint> m_visibleFirsts;
+    std::vector<GLsizei> m_visibleCounts;
+    /// Ranges from cropRanges().
+    std::vector<GLint> m_cropFirsts;
+    std::vector<GLsizei> m_cropCounts;
+    bool m_isTrackShaderActive;
+
+    static ofShader m_trackShader;
+    static bool m_isTrackShaderSetup;
+    static bool m_isTrackShaderLoaded;
+    /// The track shader is bound by beginTrailBatch().
+    static bool m_isTrailBatchActive;
 #endif
 };
 
@@ -12,6 +12,9 @@ ZoomAnimation::ZoomAnimation(const AppSettings& settings,
     , m_zoomAnimFrames(settings.getZoomAnimFrames())
     , m_zoomAnimType(settings.getZoomAnimationCriteria())
     , m_animateXY(!settings.isBoundingBoxFixed())
+    , m_isFrameIndexFound(false)
+    , m_frameIndex(0)
+    , m_numSearched(0)
 {
     const double damp = settings.getZoomAnimationDamp();
     const double attr = settings.getZoomAnimationAttraction();
@@ -23,6 +26,7 @@ ZoomAnimation::ZoomAnimation(const AppSettings& settings,
                              0.0f, dampCenter, attrCenter));
 
     m_currentZoomFrame = m_zoomAnimFrames.begin();
+    m_indexedFrame = m_zoomAnimFrames.end();
 }
 
 void ZoomAnimation::update(const MagicBoxVector& magicBoxes)
@@ -129,14 +133,15 @@ bool ZoomAnimation::zoomHasChanged(const Timeline& timeline,
     }
     case 2:
     {
-        const int currentGpsId = timeline.getCurrentTimelineObj().gpsid;
-        return currentGpsId == nextFrame->gpsId;
+        // By timeline position, playback can jump over the point.
+        unsigned int frameIndex;
+        return getFrameTimelineIndex(timeline, nextFrame, frameIndex) &&
+               timeline.getCurrentCount() >= frameIndex;
     }
     case 3:
     {
-        const std::string& currentTimestamp =
-            timeline.getCurrentTimelineObj().timeString;
-        return nextFrame->timestamp.compare(currentTimestamp) == 0;
+        // Playback by time can pass over the exact timestamp.
+        return timeline.getCurrentTimelineObj().secs >= nextFrame->time;
     }
     default:
         return false;
@@ -144,3 +149,27 @@ bool ZoomAnimation::zoomHasChanged(const Timeline& timeline,
 }
 
 //------------------------------------------------------------------------------
+
+bool ZoomAnimation::getFrameTimelineIndex(const Timeline& timeline,
+                                          tZoomAnimFrameIterator frame,
+                                          unsigned int& index)
+{
+    if (frame != m_indexedFrame)
+    {
+        m_indexedFrame = frame;
+        m_isFrameIndexFound = false;
+        m_numSearched = 0;
+    }
+    if (!m_isFrameIndexFound)
+    {
+        // Streamed points are only appended to the timeline.
+        m_isFrameIndexFound = timeline.findGpsPointId(frame->gpsId,
+                                                      m_numSearched,
+                                                      m_frameIndex);
+        m_numSearched = timeline.getAllCount();
+    }
+    index = m_frameIndex;
+    return m_isFrameIndexFound;
+}
+
+//------------------------------------------------------------------------------
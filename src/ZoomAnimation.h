@@ -22,6 +22,17 @@ private:
     bool zoomHasChanged(const Timeline& timeline,
                         tZoomAnimFrameIterator nextFrame);
 
+    /**
+    * \brief Get the timeline index of the gpsId of a frame.
+    *
+    * Cached for the frame, while the timeline grows only new entries are
+    * searched.
+    * \return false if the point is not in the timeline yet.
+    */
+    bool getFrameTimelineIndex(const Timeline& timeline,
+                               tZoomAnimFrameIterator frame,
+                               unsigned int& index);
+
     // const AppSettings& m_settings;
     const TimelineWeak m_timeline;
 
@@ -33,6 +44,11 @@ private:
 
     int m_zoomAnimType;
     bool m_animateXY;
+
+    tZoomAnimFrameIterator m_indexedFrame;
+    bool m_isFrameIndexFound;
+    unsigned int m_frameIndex;
+    unsigned int m_numSearched;
 };
 
 #endif // ZOOMANIMATION_H
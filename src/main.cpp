@@ -30,19 +30,24 @@ int main(int argc, const char* argv[] ){
         TCLAP::ValueArg<std::string> settingsArg(
             "c", "config", "Configuration file name (default: AppSettings.xml)",
             false, "AppSettings.xml", "file-name");
+        TCLAP::SwitchArg rebuildCacheArg(
+            "", "rebuild-cache", "Query the database and rebuild the GpsData cache",
+            false);
 
         cmd.add(heightArg);
         cmd.add(widthArg);
         cmd.add(settingsArg);
+        cmd.add(rebuildCacheArg);
 
         cmd.parse(argc, argv);
 
         int width = widthArg.getValue();
         int height = heightArg.getValue();
         std::string settingsFile = settingsArg.getValue();
+        bool rebuildCache = rebuildCacheArg.getValue();
 
         ofSetupOpenGL(width, height, OF_WINDOW);
-        ofRunApp( new DrawingLifeApp(settingsFile));
+        ofRunApp( new DrawingLifeApp(settingsFile, rebuildCache));
     }
     catch (TCLAP::ArgException &e)  // catch any exceptions
     {